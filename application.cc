@@ -48,7 +48,7 @@ void restArg::transMaker(coenv &e, Int size, bool rest) {
 void restArg::trans(coenv &e, temp_vector &temps)
 {
   // Push the values on the stack.
-  for (mem::list<arg *>::iterator p = inits.begin(); p != inits.end(); ++p)
+  for (arg_list::iterator p = inits.begin(); p != inits.end(); ++p)
     (*p)->trans(e, temps);
 
   if (rest)
@@ -681,10 +681,10 @@ void sameApplications(app_list a, app_list b, testExactType te) {
     assert(equivalent(a.front()->getType(), b.front()->getType()));
 }
 
-app_list multimatch(env &e,
-                    types::overloaded *o,
-                    types::signature *source,
-                    arglist &al)
+app_list uncachedMultimatch(env &e,
+                            types::overloaded *o,
+                            types::signature *source,
+                            arglist &al)
 {
   app_list a = exactMultimatch(e, o, source, al);
   if (!a.empty()) {
@@ -710,4 +710,133 @@ app_list multimatch(env &e,
   return inexactMultimatch(e, o, source, al);
 }
 
+// Overload resolution depends only on the types of the candidates, the types
+// and names of the arguments, and the implicit casts in the environment.  For
+// each set of candidates and signature of the arguments, this remembers the
+// functions chosen, so that a later call need only match the arguments to
+// them.  The applications themselves cannot be kept, as they refer to the
+// arguments of the call.
+class resolutionCache : public gc {
+  struct sighash {
+    size_t operator()(const signature *sig) const {
+      size_t x=sig->hash();
+      for (formal_vector::const_iterator i=sig->formals.begin();
+           i!=sig->formals.end(); ++i)
+        x=x*0xBEAD+i->name.hash();
+      return sig->rest.t ? x*0xACED+sig->rest.name.hash() : x;
+    }
+  };
+  struct sigeq {
+    bool operator()(const signature *s1, const signature *s2) const {
+      return argumentEquivalent(s1, s2);
+    }
+  };
+  typedef mem::unordered_map<const signature *, ty_vector,
+                             sighash, sigeq> sigmap;
+
+  // The functions chosen from one set of candidates.
+  struct choices : public gc {
+    ty_vector candidates;
+    sigmap chosen;
+
+    choices(const ty_vector& candidates)
+      : candidates(candidates) {}
+  };
+
+  // Overloaded types are modified as variables enter and leave scope, so
+  // sets of candidates are compared by their contents.
+  struct candhash {
+    size_t operator()(const ty_vector *v) const {
+      size_t x=v->size();
+      for (ty_vector::const_iterator i=v->begin(); i!=v->end(); ++i)
+        x=x*0xFACE + (size_t)*i;
+      return x;
+    }
+  };
+  struct candeq {
+    bool operator()(const ty_vector *v, const ty_vector *w) const {
+      return *v == *w;
+    }
+  };
+  typedef mem::unordered_map<const ty_vector *, choices *,
+                             candhash, candeq> candmap;
+  candmap sets;
+
+  // The generation of the implicit casts the choices were made with.
+  size_t generation;
+
+public:
+  resolutionCache(size_t generation)
+    : generation(generation) {}
+
+  bool current(size_t castGeneration) {
+    return generation == castGeneration;
+  }
+
+  // Returns the functions chosen from the candidates for arguments of the
+  // source signature; found is set to false if no choice has been recorded,
+  // in which case the returned vector is to be filled in.
+  ty_vector& lookup(overloaded *o, signature *source, bool& found) {
+    candmap::iterator p=sets.find(&o->sub);
+    if (p == sets.end()) {
+      choices *c=new choices(o->sub);
+      p=sets.insert(candmap::value_type(&c->candidates, c)).first;
+    }
+
+    std::pair<sigmap::iterator, bool> q=
+      p->second->chosen.insert(sigmap::value_type(source, ty_vector()));
+    found=!q.second;
+    return q.first->second;
+  }
+};
+
+// Only signatures whose argument types are known can be hashed.
+bool cacheable(signature *source) {
+  for (formal_vector::iterator i=source->formals.begin();
+       i!=source->formals.end(); ++i)
+    if (i->t->kind == ty_overloaded)
+      return false;
+  return !source->rest.t || source->rest.t->kind != ty_overloaded;
+}
+
+app_list multimatch(env &e,
+                    types::overloaded *o,
+                    types::signature *source,
+                    arglist &al)
+{
+  if (!cacheable(source))
+    return uncachedMultimatch(e, o, source, al);
+
+  size_t generation=e.ve.castGeneration();
+  if (!e.resolutions || !e.resolutions->current(generation))
+    e.resolutions=new resolutionCache(generation);
+
+  bool found;
+  ty_vector& chosen=e.resolutions->lookup(o, source, found);
+
+  if (found) {
+    app_list l;
+    for (ty_vector::iterator t=chosen.begin(); t!=chosen.end(); ++t) {
+      application *a=application::match(e, (function *)*t, source, al);
+      if (!a)
+        break;
+      l.push_back(a);
+    }
+
+    if (l.size() == chosen.size()) {
+#if DEBUG_CACHE
+      sameApplications(l, uncachedMultimatch(e, o, source, al),
+                       DONT_TEST_EXACT);
+#endif
+      return l;
+    }
+  }
+
+  app_list l=uncachedMultimatch(e, o, source, al);
+  chosen.clear();
+  for (app_list::iterator a=l.begin(); a!=l.end(); ++a)
+    chosen.push_back((*a)->getType());
+  return l;
+}
+
 } // namespace trans
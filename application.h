@@ -15,6 +15,7 @@
 #include "types.h"
 #include "coenv.h"
 #include "exp.h"
+#include "arena.h"
 
 // Defined in runtime.in:
 namespace run {
@@ -31,7 +32,10 @@ namespace trans {
 
 typedef Int score;
 
-typedef mem::vector<score> score_vector;
+// Applications, and the arguments they match, are only needed while a call is
+// translated, so they are allocated from the arena of the module being
+// translated, if any.
+typedef std::vector<score, mem::arena_allocator<score> > score_vector;
 
 // This is used during the translation of arguments to store temporary
 // expressions for arguments that need to be translated for side-effects at a
@@ -42,7 +46,7 @@ typedef mem::vector<score> score_vector;
 // temporary.
 typedef mem::vector<tempExp *> temp_vector;
 
-struct arg : public gc {
+struct arg : public mem::arenaObject {
   types::ty *t;
 
   arg(types::ty *t)
@@ -85,13 +89,14 @@ struct defaultArg : public arg {
 
 // Handles translation of all the arguments matched to the rest formal.
 // NOTE: This code duplicates a lot of arrayinit.
-struct restArg : public gc {
-  mem::list<arg *> inits;
+struct restArg : public mem::arenaObject {
+  typedef std::list<arg *, mem::arena_allocator<arg *> > arg_list;
+  arg_list inits;
 
   arg *rest;
 public:
   restArg()
-    : rest(0) {}
+    : inits(mem::scoped<arg *>()), rest(0) {}
 
   virtual ~restArg()
   {}
@@ -126,7 +131,8 @@ class sequencer {
     }
   };
 
-  typedef mem::vector<sequencedArg *> sa_vector;
+  typedef std::vector<sequencedArg *,
+                      mem::arena_allocator<sequencedArg *> > sa_vector;
   sa_vector args;
 
   // Makes a temporary for the next argument in the sequence.
@@ -165,6 +171,9 @@ class sequencer {
   }
 
 public:
+  sequencer()
+    : args(mem::scoped<sequencedArg *>()) {}
+
   arg *addArg(varinit *v, types::ty *t, size_t i) {
     if (args.size() <= i)
       args.resize(i+1);
@@ -173,7 +182,7 @@ public:
 };
 
 
-class application : public gc {
+class application : public mem::arenaObject {
   types::signature *sig;
   types::function *t;
 
@@ -181,7 +190,7 @@ class application : public gc {
   // Use of this sequencer means that transArgs can only be called once.
   sequencer seq;
 
-  typedef mem::vector<arg *> arg_vector;
+  typedef std::vector<arg *, mem::arena_allocator<arg *> > arg_vector;
   arg_vector args;
   restArg *rest;
 
@@ -202,19 +211,21 @@ class application : public gc {
   application(types::signature *sig)
     : sig(sig),
       t(0),
-      args(sig->formals.size()),
+      args(sig->formals.size(), 0, mem::scoped<arg *>()),
       rest(0),
       rf(0),
-      index(0)
+      index(0),
+      scores(mem::scoped<score>())
   { assert(sig); initRest(); }
 
   application(types::function *t)
     : sig(t->getSignature()),
       t(t),
-      args(sig->formals.size()),
+      args(sig->formals.size(), 0, mem::scoped<arg *>()),
       rest(0),
       rf(0),
-      index(0)
+      index(0),
+      scores(mem::scoped<score>())
   { assert(sig); initRest(); }
 
   types::formal &getTarget() {
@@ -298,7 +309,13 @@ public:
   bool halfExact();
 };
 
-typedef mem::list<application *> app_list;
+// Lists of applications are made with the arena of the applications.
+struct app_list
+  : public std::list<application *, mem::arena_allocator<application *> > {
+  app_list()
+    : std::list<application *, mem::arena_allocator<application *> >(
+        mem::scoped<application *>()) {}
+};
 
 // Given an overloaded list of types, determines which type to call.  If none
 // are applicable, returns an empty vector, if there is ambiguity, several will
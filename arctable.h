@@ -0,0 +1,201 @@
+/*****
+ * arctable.h
+ *
+ * Tables of the arc length along a path or path3, built the first time an
+ * arc length is needed, from which arc times are found by binary search and
+ * a few Newton steps within one piece of a segment.
+ *****/
+
+#ifndef ARCTABLE_H
+#define ARCTABLE_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "common.h"
+#include "camperror.h"
+
+namespace camp {
+
+// The nodes and weights of 8-point Gauss-Legendre quadrature on [-1,1].
+const double GLnodes[]={0.1834346424956498049394761,
+                        0.5255324099163289858177390,
+                        0.7966664774136267395915539,
+                        0.9602898564975362316835609};
+const double GLweights[]={0.3626837833783619829651504,
+                          0.3137066458778872873379622,
+                          0.2223810344533744705443560,
+                          0.1012285362903762591525314};
+
+// The speed along the Bezier segment z0..controls c0 and c1..z1.
+template<class T>
+class bezierSpeed {
+  T a,b,c;
+public:
+  bezierSpeed(const T& z0, const T& c0, const T& c1, const T& z1) :
+    a(z1-z0+3.0*(c0-c1)), b(2.0*(z0+c1)-4.0*c0), c(c0-z0) {}
+
+  double operator()(double t) const {
+    return 3.0*((t*a+b)*t+c).length();
+  }
+
+  // The arc length from t=u to t=v.
+  double length(double u, double v) const {
+    double h=0.5*(v-u), m=0.5*(u+v), sum=0.0;
+    for(size_t i=0; i < 4; ++i) {
+      double dt=h*GLnodes[i];
+      sum += GLweights[i]*((*this)(m-dt)+(*this)(m+dt));
+    }
+    return h*sum;
+  }
+};
+
+// A piece of a segment ending at the given time, over which quadrature of
+// the speed has converged.
+struct arcPiece {
+  double time;
+  double length;     // The arc length from the start of the path to time.
+  double speed[2];   // The speed at the start and end of the piece.
+};
+
+class arcTable : public gc {
+  // Piece k runs from the end of piece k-1 to its own end; piece 0 only
+  // marks the start of the path.
+  mem::vector<arcPiece> pieces;
+
+  void add(double time, double length, double speed0, double speed1) {
+    arcPiece p={time,pieces.back().length+length,{speed0,speed1}};
+    pieces.push_back(p);
+  }
+
+  // Divides [u,v] of segment i, along which the arc length is estimated to
+  // be L, until the estimate agrees with the sum of its halves within tol.
+  template<class T>
+  void divide(Int i, const bezierSpeed<T>& f, double u, double v, double L,
+              double tol, unsigned depth) {
+    double m=0.5*(u+v);
+    double left=f.length(u,m), right=f.length(m,v);
+    if(fabs(left+right-L) <= tol) {
+      add(i+v,left+right,f(u),f(v));
+      return;
+    }
+    if(depth == 0)
+      reportError("nesting capacity exceeded in computing arclength");
+    divide(i,f,u,m,left,tol,depth-1);
+    divide(i,f,m,v,right,tol,depth-1);
+  }
+
+  // The time within piece k, of segment i, at which the arc length from the
+  // start of the piece is goal.
+  template<class T>
+  double invert(size_t k, Int i, const bezierSpeed<T>& f, double goal) const {
+    const arcPiece& a=pieces[k-1];
+    const arcPiece& b=pieces[k];
+    double u=a.time-i, v=b.time-i, h=v-u;
+    double L=b.length-a.length;
+    double x=goal/L;
+
+    // Start from the cubic with the lengths and inverse speeds of the piece
+    // at its ends.
+    double t=u+x*h;
+    if(b.speed[0] > 0 && b.speed[1] > 0) {
+      double x2=x*x, x3=x2*x;
+      t=u+(x3-2*x2+x)*L/b.speed[0]+(3*x2-2*x3)*h+(x3-x2)*L/b.speed[1];
+      t=std::min(std::max(t,u),v);
+    }
+
+    double lo=u, hi=v;
+    double tol=100.0*DBL_EPSILON*b.length;
+    for(size_t n=0; n < 32; ++n) {
+      double F=f.length(u,t)-goal;
+      if(fabs(F) <= tol) break;
+      if(F < 0) lo=t;
+      else hi=t;
+      double s=f(t);
+      double next=s > 0 ? t-F/s : lo;
+      if(next <= lo || next >= hi) next=0.5*(lo+hi);
+      if(fabs(next-t) <= DBL_EPSILON*(i+1)) break;
+      t=next;
+    }
+    return i+t;
+  }
+
+public:
+  // Builds the table of the path p.
+  template<class Path>
+  arcTable(const Path& p) {
+    arcPiece start={0.0,0.0,{0.0,0.0}};
+    pieces.push_back(start);
+    Int n=p.length();
+    for(Int i=0; i < n; ++i) {
+      bezierSpeed<decltype(p.point(i))>
+        f(p.point(i),p.postcontrol(i),p.precontrol(i+1),p.point(i+1));
+      if(p.straight(i)) {
+        double L=(p.point(i+1)-p.point(i)).length();
+        add(i+1,L,L,L);
+      } else {
+        double L=f.length(0.0,1.0);
+        divide(i,f,0.0,1.0,L,100.0*DBL_EPSILON*L,48);
+      }
+    }
+  }
+
+  double length() const {
+    return pieces.back().length;
+  }
+
+  // The time along p, which must be the path of the table, of an arc length
+  // of goal, with 0 <= goal < length().
+  template<class Path>
+  double time(const Path& p, double goal) const {
+    arcPiece g={0.0,goal,{0.0,0.0}};
+    size_t k=std::lower_bound(pieces.begin()+1,pieces.end(),g,
+                              [](const arcPiece& a, const arcPiece& b) {
+                                return a.length < b.length;
+                              })-pieces.begin();
+    const arcPiece& b=pieces[k];
+    if(b.length == goal) return b.time;
+    const arcPiece& a=pieces[k-1];
+    double x=goal-a.length;
+    Int i=(Int) std::floor(a.time);
+    if(p.straight(i))
+      return a.time+x/(b.length-a.length);
+    bezierSpeed<decltype(p.point(i))>
+      f(p.point(i),p.postcontrol(i),p.precontrol(i+1),p.point(i+1));
+    return invert(k,i,f,x);
+  }
+};
+
+// The time along p, with arc length table T, at which the arc length is goal.
+// Along a cyclic path, a goal outside [0,length) wraps around the cycle.
+template<class Path>
+double arctime(const Path& p, const arcTable& T, double goal)
+{
+  Int n=p.size();
+  double L=T.length();
+  if(p.cyclic()) {
+    if(goal == 0 || L == 0) return 0;
+    if(goal < 0) {
+      // Measure back from the end of the cycle.
+      goal=-goal;
+      Int loops=(Int)(goal/L);
+      goal -= loops*L;
+      if(goal == 0) return -loops*n;
+      return arctime(p,T,L-goal)-(loops+1)*n;
+    }
+    if(goal >= L) {
+      Int loops=(Int)(goal/L);
+      goal -= loops*L;
+      return loops*n+arctime(p,T,goal);
+    }
+  } else {
+    if(goal <= 0) return 0;
+    if(goal >= L) return n-1;
+  }
+  return T.time(p,goal);
+}
+
+} // namespace camp
+
+#endif
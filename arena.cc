@@ -0,0 +1,84 @@
+/*****
+ * arena.cc
+ *
+ * Regions from which the short-lived data structures of the translator are
+ * allocated, and which are released in bulk once a module is translated.
+ *****/
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "arena.h"
+
+namespace mem {
+
+namespace {
+
+// The size of the first chunk of an arena; each later chunk is twice as
+// large as the one before, up to maxChunk.
+const size_t minChunk=1 << 14;
+const size_t maxChunk=1 << 20;
+
+// Chunks are scanned for pointers into the collected heap, but are never
+// collected themselves.
+inline void *allocateChunk(size_t n)
+{
+#ifdef USEGC
+  void *p=GC_MALLOC_UNCOLLECTABLE(n);
+#else
+  void *p=malloc(n);
+#endif
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+
+inline void freeChunk(void *p)
+{
+#ifdef USEGC
+  GC_FREE(p);
+#else
+  free(p);
+#endif
+}
+
+} // namespace
+
+arena *arena::currentArena=0;
+size_t arena::releasedBytes=0;
+
+arena::~arena()
+{
+  while(chunks) {
+    chunk *c=chunks;
+    chunks=c->next;
+    freeChunk(c);
+  }
+  releasedBytes += allocated;
+}
+
+void *arena::grow(size_t n)
+{
+  const size_t header=(sizeof(chunk)+alignment-1) & ~(alignment-1);
+  size_t size=chunks ? std::min(2*chunks->size,maxChunk) : minChunk;
+  if(size < header+n)
+    size=header+n;
+
+  chunk *c=(chunk *) allocateChunk(size);
+  c->size=size;
+
+  // An oversized request is given a chunk of its own, behind the current
+  // one, so that the rest of the current chunk is still used.
+  if(chunks && size-header-n < (size_t) (end-next)) {
+    c->next=chunks->next;
+    chunks->next=c;
+    return (char *) c+header;
+  }
+
+  c->next=chunks;
+  chunks=c;
+  next=(char *) c+header+n;
+  end=(char *) c+size;
+  return (char *) c+header;
+}
+
+} // namespace mem
@@ -0,0 +1,134 @@
+/*****
+ * arena.h
+ *
+ * Regions from which the short-lived data structures of the translator are
+ * allocated, and which are released in bulk once a module is translated.
+ *****/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "common.h"
+
+namespace mem {
+
+class arena {
+  struct chunk {
+    chunk *next;
+    size_t size;
+  };
+
+  chunk *chunks;
+  char *next;
+  char *end;
+  size_t allocated;
+
+  // The arena of the innermost arenaScope.
+  static arena *currentArena;
+
+  // The bytes allocated from arenas that have been released.
+  static size_t releasedBytes;
+
+  void *grow(size_t n);
+
+public:
+  arena() : chunks(0), next(0), end(0), allocated(0) {}
+  ~arena();
+
+  void *allocate(size_t n) {
+    n=(n+alignment-1) & ~(alignment-1);
+    allocated += n;
+    if((size_t) (end-next) < n)
+      return grow(n);
+    void *p=next;
+    next += n;
+    return p;
+  }
+
+  size_t size() const {
+    return allocated;
+  }
+
+  static const size_t alignment=16;
+
+  static arena *current() {
+    return currentArena;
+  }
+
+  static size_t released() {
+    return releasedBytes;
+  }
+
+  friend class arenaScope;
+};
+
+// While in scope, objects derived from arenaObject and containers using an
+// arena_allocator made with arena::current() are allocated from a new arena,
+// which is released at the end of the scope.  Nothing so allocated may be
+// referenced afterwards.
+class arenaScope {
+  arena a;
+  arena *saved;
+public:
+  arenaScope() : saved(arena::currentArena) {
+    arena::currentArena=&a;
+  }
+  ~arenaScope() {
+    arena::currentArena=saved;
+  }
+};
+
+// An object allocated from the current arena, if any, or else by the
+// garbage collector.  Its destructor is never run.
+class arenaObject {
+public:
+  void *operator new(size_t n) {
+    arena *a=arena::current();
+    return a ? a->allocate(n) : ::operator new(n, UseGC);
+  }
+  void operator delete(void *) {}
+};
+
+// An allocator drawing from the given arena, or from the garbage collector
+// if none is given.  Memory from an arena is only freed with the arena.
+template<class T>
+class arena_allocator {
+  template<class U> friend class arena_allocator;
+  arena *a;
+public:
+  typedef T value_type;
+
+  explicit arena_allocator(arena *a=0) : a(a) {}
+
+  template<class U>
+  arena_allocator(const arena_allocator<U>& other) : a(other.a) {}
+
+  T *allocate(size_t n) {
+    return a ? (T *) a->allocate(n*sizeof(T)) :
+      gc_allocator<T>().allocate(n);
+  }
+
+  void deallocate(T *p, size_t n) {
+    if(!a)
+      gc_allocator<T>().deallocate(p,n);
+  }
+
+  template<class U>
+  bool operator==(const arena_allocator<U>& other) const {
+    return a == other.a;
+  }
+  template<class U>
+  bool operator!=(const arena_allocator<U>& other) const {
+    return a != other.a;
+  }
+};
+
+// The allocator for containers owned by arena objects.
+template<class T>
+inline arena_allocator<T> scoped() {
+  return arena_allocator<T>(arena::current());
+}
+
+} // namespace mem
+
+#endif
@@ -39,15 +39,15 @@ array *array::slice(Int left, Int right)
   checkBackSlice(left, right);
 
   if (left == right)
-    return new array();
+    return new array(0, placement());
 
   size_t length=size();
   if (length == 0)
-    return new array();
+    return new array(0, placement());
 
   if (cycle) {
     size_t resultLength = (size_t)(right - left);
-    array *result = new array(resultLength);
+    array *result = new array(resultLength, placement());
 
     size_t i = (size_t)imod(left, length), ri = 0;
     while (ri < resultLength) {
@@ -66,7 +66,7 @@ array *array::slice(Int left, Int right)
     size_t r = sliceIndex(right, length);
 
     size_t resultLength = r - l;
-    array *result = new array(resultLength);
+    array *result = new array(resultLength, placement());
 
     std::copy(this->begin()+l, this->begin()+r, result->begin());
 
@@ -74,7 +74,7 @@ array *array::slice(Int left, Int right)
   }
 }
 
-void array::setNonBridgingSlice(size_t l, size_t r, mem::vector<item> *a)
+void array::setNonBridgingSlice(size_t l, size_t r, array *a)
 {
   assert(0 <= l);
   assert(l <= r);
@@ -99,7 +99,7 @@ void array::setNonBridgingSlice(size_t l, size_t r, mem::vector<item> *a)
   }
 }
 
-void array::setBridgingSlice(size_t l, size_t r, mem::vector<item> *a)
+void array::setBridgingSlice(size_t l, size_t r, array *a)
 {
   size_t len=this->size();
 
@@ -116,7 +116,7 @@ void array::setSlice(Int left, Int right, array *a)
 
   // If we are slicing an array into itself, slice in a copy instead, to ensure
   // the proper result.
-  mem::vector<item> *v = (a == this) ? new mem::vector<item>(*a) : a;
+  array *v = (a == this) ? new array(*a) : a;
 
   size_t length=size();
   if (cycle) {
@@ -171,7 +171,7 @@ array *array::copyToDepth(size_t depth)
     return this;
   } else {
     size_t n=this->size();
-    array *a=new array(n);
+    array *a=new array(n, placement());
     a->cycle = this->cycle;
 
     for (size_t i=0; i<n; ++i)
@@ -181,8 +181,8 @@ array *array::copyToDepth(size_t depth)
   }
 }
 
-array::array(size_t n, item i, size_t depth)
-  : mem::vector<item>(n), cycle(false)
+array::array(size_t n, item i, size_t depth, GCPlacement placement)
+  : arrayStorage(n, arrayAllocator<item>(placement)), cycle(false)
 {
   for (size_t k=0; k<n; ++k)
     (*this)[k] = copyItemToDepth(i, depth);
@@ -8,6 +8,8 @@
 #ifndef ARRAY_H
 #define ARRAY_H
 
+#include <type_traits>
+
 #include "vm.h"
 #include "common.h"
 #include "item.h"
@@ -16,20 +18,99 @@ namespace vm {
 
 extern const char *dereferenceNullArray;
 
+// Allocates the storage of an array.  Arrays whose cells can never point into
+// the collected heap (arrays of reals, integers, and booleans) are packed
+// into pointer-free memory that the garbage collector does not scan.
+template<class T>
+class arrayAllocator {
+  GCPlacement placement;
+
+  template<class U> friend class arrayAllocator;
+public:
+  typedef T value_type;
+
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  arrayAllocator(GCPlacement placement=UseGC) : placement(placement) {}
+
+  template<class U>
+  arrayAllocator(const arrayAllocator<U>& a) : placement(a.placement) {}
+
+  GCPlacement getPlacement() const {return placement;}
+
+  T *allocate(size_t n) {
+    mem::noteAllocation(mem::ARRAYS,n*sizeof(T));
+#ifdef USEGC
+    size_t size=n*sizeof(T);
+    return (T *) (placement == PointerFreeGC ? asy_malloc_atomic(size) :
+                  asy_malloc(size));
+#else
+    return std::allocator<T>().allocate(n);
+#endif
+  }
+
+  void deallocate(T *p, size_t n) {
+#ifdef USEGC
+    GC_FREE(p);
+#else
+    std::allocator<T>().deallocate(p,n);
+#endif
+  }
+
+  template<class U>
+  bool operator==(const arrayAllocator<U>& a) const {
+    return placement == a.placement;
+  }
+
+  template<class U>
+  bool operator!=(const arrayAllocator<U>& a) const {
+    return placement != a.placement;
+  }
+};
+
+// The placement for an array whose cells hold values of type T.
+template<class T>
+inline GCPlacement arrayPlacement() {return UseGC;}
+
+template<>
+inline GCPlacement arrayPlacement<double>() {return PointerFreeGC;}
+template<>
+inline GCPlacement arrayPlacement<Int>() {return PointerFreeGC;}
+template<>
+inline GCPlacement arrayPlacement<bool>() {return PointerFreeGC;}
+
+typedef std::vector<item, arrayAllocator<item> > arrayStorage;
+
 // Arrays are vectors with push and pop functions.
-class array : public mem::vector<item> {
+class array : public arrayStorage, public gc {
   bool cycle;
 
-  void setNonBridgingSlice(size_t l, size_t r, mem::vector<item> *a);
-  void setBridgingSlice(size_t l, size_t r, mem::vector<item> *a);
+  void setNonBridgingSlice(size_t l, size_t r, array *a);
+  void setBridgingSlice(size_t l, size_t r, array *a);
 public:
   array() : cycle(false) {}
 
   array(size_t n)
-    : mem::vector<item>(n), cycle(false)
+    : arrayStorage(n), cycle(false)
   {}
 
-  array(size_t n, item i, size_t depth);
+  // Create an array of n cells, packed if placement is PointerFreeGC.
+  array(size_t n, GCPlacement placement)
+    : arrayStorage(n, arrayAllocator<item>(placement)), cycle(false)
+  {}
+
+  array(size_t n, item i, size_t depth,
+        GCPlacement placement=UseGC);
+
+  GCPlacement placement() const {
+    return get_allocator().getPlacement();
+  }
+
+  bool packed() const {
+    return placement() == PointerFreeGC;
+  }
 
   void push(item i)
   {
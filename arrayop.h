@@ -12,8 +12,11 @@
 #include "array.h"
 #include "types.h"
 #include "fileio.h"
+#include "stringbuilder.h"
 #include "callable.h"
 #include "mathop.h"
+#include "simdop.h"
+#include "sortop.h"
 
 namespace run {
 
@@ -25,15 +28,89 @@ using camp::tab;
 vm::array *copyArray(vm::array *a);
 vm::array *copyArray2(vm::array *a);
 
+// The vectorized kernel of simdop.h, if any, implementing op elementwise on
+// arrays of T.
+template<class T, template <class S> class op>
+struct kernel {
+  static const simd::opcode code=simd::NONE;
+};
+
+#define KERNEL(T,op,c)                                          \
+  template<> struct kernel<T,op> {                              \
+    static const simd::opcode code=simd::c;                     \
+  };
+
+KERNEL(double,plus,ADD)
+KERNEL(double,minus,SUB)
+KERNEL(double,times,MUL)
+KERNEL(double,divide,DIV)
+KERNEL(double,min,MIN)
+KERNEL(double,max,MAX)
+KERNEL(double,less,LT)
+KERNEL(double,lessequals,LE)
+KERNEL(double,greaterequals,GE)
+KERNEL(double,greater,GT)
+KERNEL(double,equals,EQ)
+KERNEL(double,notequals,NE)
+
+#undef KERNEL
+
+template<class T, class S, T (*func)(S)>
+struct unaryKernel {
+  static const simd::opcode code=simd::NONE;
+};
+
+template<> struct unaryKernel<double,double,fabs> {
+  static const simd::opcode code=simd::ABS;
+};
+
+// Only arrays of reals have kernels; other operand types use the generic
+// loops below.
+inline bool arrayScalarKernel(simd::opcode code, array *c, const array *a,
+                              double b)
+{
+  return code != simd::NONE && simd::arrayScalar(code,c,a,b);
+}
+
+template<class U>
+inline bool arrayScalarKernel(simd::opcode, array *, const array *, U)
+{
+  return false;
+}
+
+inline bool scalarArrayKernel(simd::opcode code, array *c, double a,
+                              const array *b)
+{
+  return code != simd::NONE && simd::scalarArray(code,c,a,b);
+}
+
+template<class T>
+inline bool scalarArrayKernel(simd::opcode, array *, T, const array *)
+{
+  return false;
+}
+
+inline bool reduceKernel(simd::opcode code, const array *a, double& result)
+{
+  return code != simd::NONE && simd::reduce(code,a,result);
+}
+
+template<class T>
+inline bool reduceKernel(simd::opcode, const array *, T&)
+{
+  return false;
+}
+
 template<class T, class U, template <class S> class op>
 void arrayOp(vm::stack *s)
 {
   U b=pop<U>(s);
   array *a=pop<array*>(s);
   size_t size=checkArray(a);
-  array *c=new array(size);
-  for(size_t i=0; i < size; i++)
-    (*c)[i]=op<T>()(read<T>(a,i),b,i);
+  array *c=new array(size,vm::arrayPlacement<T>());
+  if(!arrayScalarKernel(kernel<T,op>::code,c,a,b))
+    for(size_t i=0; i < size; i++)
+      (*c)[i]=op<T>()(read<T>(a,i),b,i);
   s->push(c);
 }
 
@@ -43,9 +120,10 @@ void opArray(vm::stack *s)
   array *a=pop<array*>(s);
   T b=pop<T>(s);
   size_t size=checkArray(a);
-  array *c=new array(size);
-  for(size_t i=0; i < size; i++)
-    (*c)[i]=op<U>()(b,read<U>(a,i),i);
+  array *c=new array(size,vm::arrayPlacement<U>());
+  if(!scalarArrayKernel(kernel<U,op>::code,c,b,a))
+    for(size_t i=0; i < size; i++)
+      (*c)[i]=op<U>()(b,read<U>(a,i),i);
   s->push(c);
 }
 
@@ -55,9 +133,11 @@ void arrayArrayOp(vm::stack *s)
   array *b=pop<array*>(s);
   array *a=pop<array*>(s);
   size_t size=checkArrays(a,b);
-  array *c=new array(size);
-  for(size_t i=0; i < size; i++)
-    (*c)[i]=op<T>()(read<T>(a,i),read<T>(b,i),i);
+  array *c=new array(size,vm::arrayPlacement<T>());
+  if(kernel<T,op>::code == simd::NONE ||
+     !simd::arrayArray(kernel<T,op>::code,c,a,b))
+    for(size_t i=0; i < size; i++)
+      (*c)[i]=op<T>()(read<T>(a,i),read<T>(b,i),i);
   s->push(c);
 }
 
@@ -67,8 +147,9 @@ void sumArray(vm::stack *s)
   array *a=pop<array*>(s);
   size_t size=checkArray(a);
   T sum=0;
-  for(size_t i=0; i < size; i++)
-    sum += read<T>(a,i);
+  if(!reduceKernel(simd::ADD,a,sum))
+    for(size_t i=0; i < size; i++)
+      sum += read<T>(a,i);
   s->push(sum);
 }
 
@@ -80,9 +161,12 @@ void binopArray(vm::stack *s)
   array *a=pop<array*>(s);
   size_t size=checkArray(a);
   if(size == 0) vm::error(arrayempty);
-  T m=read<T>(a,0);
-  for(size_t i=1; i < size; i++)
-    m=op<T>()(m,read<T>(a,i));
+  T m;
+  if(!reduceKernel(kernel<T,op>::code,a,m)) {
+    m=read<T>(a,0);
+    for(size_t i=1; i < size; i++)
+      m=op<T>()(m,read<T>(a,i));
+  }
   s->push(m);
 }
 
@@ -147,7 +231,7 @@ void array2Op(vm::stack *s)
   for(size_t i=0; i < size; ++i) {
     array *ai=read<array*>(a,i);
     size_t aisize=checkArray(ai);
-    array *ci=new array(aisize);
+    array *ci=new array(aisize,vm::arrayPlacement<T>());
     (*c)[i]=ci;
     for(size_t j=0; j < aisize; j++)
       (*ci)[j]=op<T>()(read<T>(ai,j),b,0);
@@ -165,7 +249,7 @@ void opArray2(vm::stack *s)
   for(size_t i=0; i < size; ++i) {
     array *ai=read<array*>(a,i);
     size_t aisize=checkArray(ai);
-    array *ci=new array(aisize);
+    array *ci=new array(aisize,vm::arrayPlacement<U>());
     (*c)[i]=ci;
     for(size_t j=0; j < aisize; j++)
       (*ci)[j]=op<U>()(read<U>(ai,j),b,0);
@@ -184,7 +268,7 @@ void array2Array2Op(vm::stack *s)
     array *ai=read<array*>(a,i);
     array *bi=read<array*>(b,i);
     size_t aisize=checkArrays(ai,bi);
-    array *ci=new array(aisize);
+    array *ci=new array(aisize,vm::arrayPlacement<T>());
     (*c)[i]=ci;
     for(size_t j=0; j < aisize; j++)
       (*ci)[j]=op<T>()(read<T>(ai,j),read<T>(bi,j),0);
@@ -233,7 +317,7 @@ void diagonal(vm::stack *s)
   size_t n=checkArray(a);
   array *c=new array(n);
   for(size_t i=0; i < n; ++i) {
-    array *ci=new array(n);
+    array *ci=new array(n,vm::arrayPlacement<T>());
     (*c)[i]=ci;
     for(size_t j=0; j < i; ++j)
       (*ci)[j]=T();
@@ -244,22 +328,48 @@ void diagonal(vm::stack *s)
   s->push(c);
 }
 
+// The native order of sortop.h on T.
 template<class T>
-struct compare {
-  bool operator() (const vm::item& a, const vm::item& b)
-  {
-    return vm::get<T>(a) < vm::get<T>(b);
-  }
+struct orderOf {
+  static const sorting::order value=sorting::NONE;
+};
+
+template<> struct orderOf<Int> {
+  static const sorting::order value=sorting::INT;
+};
+template<> struct orderOf<double> {
+  static const sorting::order value=sorting::REAL;
+};
+template<> struct orderOf<string> {
+  static const sorting::order value=sorting::STRING;
 };
 
 template<class T>
 void sortArray(vm::stack *s)
 {
   array *c=copyArray(pop<array*>(s));
-  sort(c->begin(),c->end(),compare<T>());
+  sorting::sort(c,orderOf<T>::value,false);
   s->push(c);
 }
 
+// Return the indices that stably sort the array a.
+template<class T>
+void argsortArray(vm::stack *s)
+{
+  array *a=pop<array*>(s);
+  checkArray(a);
+  s->push(sorting::argsort(a,orderOf<T>::value));
+}
+
+// Return the distinct elements of the array a in ascending order.
+template<class T>
+void uniqueArray(vm::stack *s)
+{
+  array *a=pop<array*>(s);
+  checkArray(a);
+  s->push(sorting::unique(a,orderOf<T>::value));
+}
+
 template<class T>
 struct compare2 {
   bool operator() (const vm::item& A, const vm::item& B)
@@ -295,25 +405,38 @@ void searchArray(vm::stack *s)
 {
   T key=pop<T>(s);
   array *a=pop<array*>(s);
-  size_t size= a->size();
-  if(size == 0 || key < read<T>(a,0)) {s->push(-1); return;}
-  size_t u=size-1;
-  if(key >= read<T>(a,u)) {s->push((Int) u); return;}
-  size_t l=0;
-
-  while (l < u) {
-    size_t i=(l+u)/2;
-    if(key < read<T>(a,i)) u=i;
-    else if(key < read<T>(a,i+1)) {s->push((Int) i); return;}
-    else l=i+1;
-  }
-  s->push(0);
+  checkArray(a);
+  s->push(sorting::search(a,key,orderOf<T>::value));
+}
+
+// Search the sorted array a for each element of keys.
+template<class T>
+void searchsortedArray(vm::stack *s)
+{
+  array *keys=pop<array*>(s);
+  array *a=pop<array*>(s);
+  checkArray(a);
+  checkArray(keys);
+  s->push(sorting::searchsorted(a,keys,orderOf<T>::value));
 }
 
 extern string emptystring;
 
 void writestring(vm::stack *s);
 
+// The value written for x.  A string builder is written as its contents,
+// without a copy.
+template<class T>
+inline const T& writable(const T& x)
+{
+  return x;
+}
+
+inline const string& writable(camp::stringbuilder *b)
+{
+  return b->str();
+}
+
 template<class T>
 void write(vm::stack *s)
 {
@@ -328,10 +451,10 @@ void write(vm::stack *s)
 
   size_t size=checkArray(a);
   if(S != "") f->write(S);
-  f->write(first);
+  f->write(writable(first));
   for(size_t i=0; i < size; ++i) {
     f->write(tab);
-    f->write(read<T>(a,i));
+    f->write(writable(read<T>(a,i)));
   }
   if(f->text()) {
     if(suffix) {
@@ -481,9 +604,11 @@ void arrayFunc(vm::stack *s)
 {
   array *a=pop<array*>(s);
   size_t size=checkArray(a);
-  array *c=new array(size);
-  for(size_t i=0; i < size; i++)
-    (*c)[i]=func(read<S>(a,i));
+  array *c=new array(size,vm::arrayPlacement<T>());
+  simd::opcode code=unaryKernel<T,S,func>::code;
+  if(code == simd::NONE || !simd::unary(code,c,a))
+    for(size_t i=0; i < size; i++)
+      (*c)[i]=func(read<S>(a,i));
   s->push(c);
 }
 
@@ -496,7 +621,7 @@ void arrayFunc2(vm::stack *s)
   for(size_t i=0; i < size; ++i) {
     array *ai=read<array*>(a,i);
     size_t aisize=checkArray(ai);
-    array *ci=new array(aisize);
+    array *ci=new array(aisize,vm::arrayPlacement<T>());
     (*c)[i]=ci;
     for(size_t j=0; j < aisize; j++)
       (*ci)[j]=func(read<S>(ai,j));
@@ -543,7 +668,7 @@ inline void copyArrayC(T* &dest, const vm::array *a, T (*cast)(A),
 template<typename T>
 inline vm::array* copyCArray(const size_t n, const T* p)
 {
-  vm::array* a = new vm::array(n);
+  vm::array* a = new vm::array(n,vm::arrayPlacement<T>());
   for(size_t i=0; i < n; ++i) (*a)[i] = p[i];
   return a;
 }
@@ -579,7 +704,7 @@ inline vm::array* copyCArray2(const size_t n, const size_t m, const T* p)
 {
   vm::array* a=new vm::array(n);
   for(size_t i=0; i < n; ++i) {
-    array *ai=new array(m);
+    array *ai=new array(m,vm::arrayPlacement<T>());
     (*a)[i]=ai;
     for(size_t j=0; j < m; ++j)
       (*ai)[j]=p[m*i+j];
@@ -15,6 +15,7 @@
 #include "runlabel.h"
 #include "runhistory.h"
 #include "runarray.h"
+#include "runmap.h"
 #include "runfile.h"
 #include "runsystem.h"
 #include "runstring.h"
@@ -34,6 +35,7 @@
 #include "coder.h"
 #include "exp.h"
 #include "refaccess.h"
+#include "fold.h"
 #include "settings.h"
 
 #include "opsymbols.h"
@@ -69,6 +71,7 @@ void gen_runpicture_venv(venv &ve);
 void gen_runlabel_venv(venv &ve);
 void gen_runhistory_venv(venv &ve);
 void gen_runarray_venv(venv &ve);
+void gen_runmap_venv(venv &ve);
 void gen_runfile_venv(venv &ve);
 void gen_runsystem_venv(venv &ve);
 void gen_runstring_venv(venv &ve);
@@ -151,30 +154,48 @@ void addFunc(venv &ve, bltin f, ty *result, symbol name,
              formal f7, formal f8, formal f9, formal fA, formal fB, formal fC,
              formal fD, formal fE, formal fF, formal fG, formal fH, formal fI)
 {
-#ifdef DEBUG_BLTIN
-  // If the function is an operator, print out the whole signature with the
-  // types, as operators are heavily overloaded.  min and max are also heavily
-  // overloaded, so we check for them too.  Many builtin functions have so
-  // many arguments that it is noise to print out their full signatures.
-  string s = name;
-  if (s.find("operator ", 0) == 0 || s == "min" || s == "max")
-    {
-      function *fun = functionFromFormals(result,f1,f2,f3,f4,f5,f6,f7,f8,f9,
-                                          fA,fB,fC,fD,fE,fF,fG,fH,fI);
-      ostringstream out;
-      fun->printVar(out, name);
-      REGISTER_BLTIN(f, out.str());
+  if (NAMING_BLTINS) {
+    // If the function is an operator, print out the whole signature with the
+    // types, as operators are heavily overloaded.  min and max are also
+    // heavily overloaded, so we check for them too.  Many builtin functions
+    // have so many arguments that it is noise to print out their full
+    // signatures.
+    string s = name;
+    if (s.find("operator ", 0) == 0 || s == "min" || s == "max")
+      {
+        function *fun = functionFromFormals(result,f1,f2,f3,f4,f5,f6,f7,f8,
+                                            f9,fA,fB,fC,fD,fE,fF,fG,fH,fI);
+        ostringstream out;
+        fun->printVar(out, name);
+        REGISTER_BLTIN(f, out.str());
+      }
+    else {
+      REGISTER_BLTIN(f, name);
     }
-  else {
-    REGISTER_BLTIN(f, name);
   }
-#endif
 
   access *a = new bltinAccess(f);
   addFunc(ve,a,result,name,f1,f2,f3,f4,f5,f6,f7,f8,f9,
           fA,fB,fC,fD,fE,fF,fG,fH,fI);
 }
 
+void addPureFunc(venv &ve, bltin f, ty *result, symbol name,
+                 formal f1, formal f2, formal f3, formal f4, formal f5,
+                 formal f6, formal f7, formal f8, formal f9, formal fA,
+                 formal fB, formal fC, formal fD, formal fE, formal fF,
+                 formal fG, formal fH, formal fI)
+{
+  addFunc(ve,f,result,name,f1,f2,f3,f4,f5,f6,f7,f8,f9,
+          fA,fB,fC,fD,fE,fF,fG,fH,fI);
+
+  const formal *formals[]={&f1,&f2,&f3,&f4,&f5,&f6,&f7,&f8,&f9,
+                           &fA,&fB,&fC,&fD,&fE,&fF,&fG,&fH,&fI};
+  size_t n=0;
+  while (n < sizeof(formals)/sizeof(formal *) && formals[n]->t)
+    ++n;
+  vm::markPure(f,n);
+}
+
 void addOpenFunc(venv &ve, bltin f, ty *result, symbol name)
 {
   function *fun = new function(result, signature::OPEN);
@@ -223,7 +244,7 @@ void addRealFunc0(venv &ve, bltin fcn, symbol name)
 template<double (*fcn)(double)>
 void addRealFunc(venv &ve, symbol name)
 {
-  addFunc(ve, realReal<fcn>, primReal(), name, formal(primReal(),SYM(x)));
+  addPureFunc(ve, realReal<fcn>, primReal(), name, formal(primReal(),SYM(x)));
   addFunc(ve, arrayFunc<double,double,fcn>, realArray(), name,
           formal(realArray(),SYM(a)));
 }
@@ -232,8 +253,8 @@ void addRealFunc(venv &ve, symbol name)
 
 void addRealFunc2(venv &ve, bltin fcn, symbol name)
 {
-  addFunc(ve,fcn,primReal(),name,formal(primReal(),SYM(a)),
-          formal(primReal(),SYM(b)));
+  addPureFunc(ve,fcn,primReal(),name,formal(primReal(),SYM(a)),
+              formal(primReal(),SYM(b)));
 }
 
 template <double (*func)(double, int)>
@@ -246,8 +267,8 @@ void realRealInt(vm::stack *s) {
 template<double (*fcn)(double, int)>
 void addRealIntFunc(venv& ve, symbol name, symbol arg1,
                     symbol arg2) {
-  addFunc(ve, realRealInt<fcn>, primReal(), name, formal(primReal(), arg1),
-          formal(primInt(), arg2));
+  addPureFunc(ve, realRealInt<fcn>, primReal(), name,
+              formal(primReal(), arg1), formal(primInt(), arg2));
 }
 
 void addInitializer(venv &ve, ty *t, access *a)
@@ -257,11 +278,11 @@ void addInitializer(venv &ve, ty *t, access *a)
 
 void addInitializer(venv &ve, ty *t, bltin f)
 {
-#ifdef DEBUG_BLTIN
-  ostringstream s;
-  s << "initializer for " << *t;
-  REGISTER_BLTIN(f, s.str());
-#endif
+  if (NAMING_BLTINS) {
+    ostringstream s;
+    s << "initializer for " << *t;
+    REGISTER_BLTIN(f, s.str());
+  }
   access *a = new bltinAccess(f);
   addInitializer(ve, t, a);
 }
@@ -280,23 +301,34 @@ void addCast(venv &ve, ty *target, ty *source, access *a) {
 }
 
 void addExplicitCast(venv &ve, ty *target, ty *source, bltin f) {
-#ifdef DEBUG_BLTIN
-  ostringstream s;
-  s << "explicit cast from " << *source << " to " << *target;
-  REGISTER_BLTIN(f, s.str());
-#endif
+  if (NAMING_BLTINS) {
+    ostringstream s;
+    s << "explicit cast from " << *source << " to " << *target;
+    REGISTER_BLTIN(f, s.str());
+  }
   addExplicitCast(ve, target, source, new bltinAccess(f));
 }
 
 void addCast(venv &ve, ty *target, ty *source, bltin f) {
-#ifdef DEBUG_BLTIN
-  ostringstream s;
-  s << "cast from " << *source << " to " << *target;
-  REGISTER_BLTIN(f, s.str());
-#endif
+  if (NAMING_BLTINS) {
+    ostringstream s;
+    s << "cast from " << *source << " to " << *target;
+    REGISTER_BLTIN(f, s.str());
+  }
   addCast(ve, target, source, new bltinAccess(f));
 }
 
+// Casts between types with value semantics are pure, as in addPureFunc.
+void addPureExplicitCast(venv &ve, ty *target, ty *source, bltin f) {
+  addExplicitCast(ve, target, source, f);
+  vm::markPure(f, 1);
+}
+
+void addPureCast(venv &ve, ty *target, ty *source, bltin f) {
+  addCast(ve, target, source, f);
+  vm::markPure(f, 1);
+}
+
 template<class T>
 void addVariable(venv &ve, T *ref, ty *t, symbol name,
                  record *module=settings::getSettingsModule()) {
@@ -305,6 +337,13 @@ void addVariable(venv &ve, T *ref, ty *t, symbol name,
   ve.enter(name, ent);
 }
 
+void addVariable(venv &ve, bltin read, bltin write, ty *t, symbol name,
+                 record *module=settings::getSettingsModule()) {
+  access *a = new bltinRefAccess(read, write);
+  varEntry *ent = new varEntry(t, a, PUBLIC, module, 0, position());
+  ve.enter(name, ent);
+}
+
 template<class T>
 void addVariable(venv &ve, T value, ty *t, symbol name,
                  record *module=settings::getSettingsModule(),
@@ -319,7 +358,9 @@ void addVariable(venv &ve, T value, ty *t, symbol name,
 template<class T>
 void addConstant(venv &ve, T value, ty *t, symbol name,
                  record *module=settings::getSettingsModule()) {
-  addVariable(ve,value,t,name,module,RESTRICTED);
+  access *a = new constAccess(value);
+  varEntry *ent = new varEntry(t, a, RESTRICTED, module, 0, position());
+  ve.enter(name, ent);
 }
 
 // The identity access, i.e. no instructions are encoded for a cast or
@@ -357,24 +398,25 @@ void addInitializers(venv &ve)
   addInitializer(ve, primPen(), newPen);
   addInitializer(ve, primPicture(), newPicture);
   addInitializer(ve, primFile(), nullFile);
+  addInitializer(ve, primStringBuilder(), newStringBuilder);
 }
 
 void addCasts(venv &ve)
 {
-  addExplicitCast(ve, primString(), primInt(), stringCast<Int>);
-  addExplicitCast(ve, primString(), primReal(), stringCast<double>);
-  addExplicitCast(ve, primString(), primPair(), stringCast<pair>);
-  addExplicitCast(ve, primString(), primTriple(), stringCast<triple>);
-  addExplicitCast(ve, primInt(), primString(), castString<Int>);
-  addExplicitCast(ve, primReal(), primString(), castString<double>);
-  addExplicitCast(ve, primPair(), primString(), castString<pair>);
-  addExplicitCast(ve, primTriple(), primString(), castString<triple>);
+  addPureExplicitCast(ve, primString(), primInt(), stringCast<Int>);
+  addPureExplicitCast(ve, primString(), primReal(), stringCast<double>);
+  addPureExplicitCast(ve, primString(), primPair(), stringCast<pair>);
+  addPureExplicitCast(ve, primString(), primTriple(), stringCast<triple>);
+  addPureExplicitCast(ve, primInt(), primString(), castString<Int>);
+  addPureExplicitCast(ve, primReal(), primString(), castString<double>);
+  addPureExplicitCast(ve, primPair(), primString(), castString<pair>);
+  addPureExplicitCast(ve, primTriple(), primString(), castString<triple>);
 
-  addExplicitCast(ve, primInt(), primReal(), castDoubleInt);
+  addPureExplicitCast(ve, primInt(), primReal(), castDoubleInt);
 
-  addCast(ve, primReal(), primInt(), cast<Int,double>);
-  addCast(ve, primPair(), primInt(), cast<Int,pair>);
-  addCast(ve, primPair(), primReal(), cast<double,pair>);
+  addPureCast(ve, primReal(), primInt(), cast<Int,double>);
+  addPureCast(ve, primPair(), primInt(), cast<Int,pair>);
+  addPureCast(ve, primPair(), primReal(), cast<double,pair>);
 
   addCast(ve, primPath(), primPair(), cast<pair,path>);
   addCast(ve, primGuide(), primPair(), pairToGuide);
@@ -397,20 +439,20 @@ void addCasts(venv &ve)
 
 void addTupleOperators(venv &ve)
 {
-  addFunc(ve, realRealToPair, primPair(), SYM_TUPLE,
-          formal(primReal(), SYM(x)),
-          formal(primReal(), SYM(y)));
-  addFunc(ve, realRealRealToTriple, primTriple(), SYM_TUPLE,
-          formal(primReal(), SYM(x)),
-          formal(primReal(), SYM(y)),
-          formal(primReal(), SYM(z)));
-  addFunc(ve, real6ToTransform, primTransform(), SYM_TUPLE,
-          formal(primReal(), SYM(x)),
-          formal(primReal(), SYM(y)),
-          formal(primReal(), SYM(xx)),
-          formal(primReal(), SYM(xy)),
-          formal(primReal(), SYM(yx)),
-          formal(primReal(), SYM(yy)));
+  addPureFunc(ve, realRealToPair, primPair(), SYM_TUPLE,
+              formal(primReal(), SYM(x)),
+              formal(primReal(), SYM(y)));
+  addPureFunc(ve, realRealRealToTriple, primTriple(), SYM_TUPLE,
+              formal(primReal(), SYM(x)),
+              formal(primReal(), SYM(y)),
+              formal(primReal(), SYM(z)));
+  addPureFunc(ve, real6ToTransform, primTransform(), SYM_TUPLE,
+              formal(primReal(), SYM(x)),
+              formal(primReal(), SYM(y)),
+              formal(primReal(), SYM(xx)),
+              formal(primReal(), SYM(xy)),
+              formal(primReal(), SYM(yx)),
+              formal(primReal(), SYM(yy)));
 }
 
 void addGuideOperators(venv &ve)
@@ -430,6 +472,14 @@ void addBooleanOperator(venv &ve, bltin f, ty *t, symbol name)
 {
   addFunc(ve,f,primBoolean(),name,formal(t,SYM(a)),formal(t,SYM(b)));
 }
+void addPureOperator(venv &ve, bltin f, ty *t, symbol name)
+{
+  addPureFunc(ve,f,t,name,formal(t,SYM(a)),formal(t,SYM(b)));
+}
+void addPureBooleanOperator(venv &ve, bltin f, ty *t, symbol name)
+{
+  addPureFunc(ve,f,primBoolean(),name,formal(t,SYM(a)),formal(t,SYM(b)));
+}
 
 template<class T, template <class S> class op>
 void addArray2Array2Op(venv &ve, ty *t3, symbol name)
@@ -452,7 +502,7 @@ void addArray2Op(venv &ve, ty *t1, symbol name, ty *t3)
 template<class T, template <class S> class op>
 void addOps(venv &ve, ty *t1, symbol name, ty *t2)
 {
-  addSimpleOperator(ve,binaryOp<T,op>,t1,name);
+  addPureOperator(ve,binaryOp<T,op>,t1,name);
   addFunc(ve,opArray<T,T,op>,t2,name,formal(t1,SYM(a)),formal(t2,SYM(b)));
   addFunc(ve,arrayOp<T,T,op>,t2,name,formal(t2,SYM(a)),formal(t1,SYM(b)));
   addSimpleOperator(ve,arrayArrayOp<T,op>,t2,name);
@@ -461,7 +511,7 @@ void addOps(venv &ve, ty *t1, symbol name, ty *t2)
 template<class T, template <class S> class op>
 void addBooleanOps(venv &ve, ty *t1, symbol name, ty *t2)
 {
-  addBooleanOperator(ve,binaryOp<T,op>,t1,name);
+  addPureBooleanOperator(ve,binaryOp<T,op>,t1,name);
   addFunc(ve,opArray<T,T,op>,
           booleanArray(),name,formal(t1,SYM(a)),formal(t2,SYM(b)));
   addFunc(ve,arrayOp<T,T,op>,
@@ -549,6 +599,10 @@ void addOrderedOps(venv &ve, ty *t1, ty *t2, ty *t3, ty *t4)
 
   addFunc(ve,searchArray<T>,primInt(),SYM(search),formal(t2,SYM(a)),
           formal(t1,SYM(key)));
+  addFunc(ve,searchsortedArray<T>,IntArray(),SYM(searchsorted),
+          formal(t2,SYM(a)),formal(t2,SYM(keys)));
+  addFunc(ve,argsortArray<T>,IntArray(),SYM(argsort),formal(t2,SYM(a)));
+  addFunc(ve,uniqueArray<T>,t2,SYM(unique),formal(t2,SYM(a)));
 }
 
 template<class T>
@@ -564,13 +618,13 @@ void addBasicOps(venv &ve, ty *t1, ty *t2, ty *t3, ty *t4, bool integer=false,
 
   addFunc(ve,&id,t1,SYM_PLUS,formal(t1,SYM(a)));
   addFunc(ve,&id,t2,SYM_PLUS,formal(t2,SYM(a)));
-  addFunc(ve,Negate<T>,t1,SYM_MINUS,formal(t1,SYM(a)));
+  addPureFunc(ve,Negate<T>,t1,SYM_MINUS,formal(t1,SYM(a)));
   addFunc(ve,arrayFunc<T,T,negate>,t2,SYM_MINUS,formal(t2,SYM(a)));
   addFunc(ve,arrayFunc2<T,T,negate>,t3,SYM_MINUS,formal(t3,SYM(a)));
-  if(!integer) addFunc(ve,interp<T>,t1,SYM(interp),
-                       formal(t1,SYM(a),false,Explicit),
-                       formal(t1,SYM(b),false,Explicit),
-                       formal(primReal(),SYM(t)));
+  if(!integer) addPureFunc(ve,interp<T>,t1,SYM(interp),
+                           formal(t1,SYM(a),false,Explicit),
+                           formal(t1,SYM(b),false,Explicit),
+                           formal(primReal(),SYM(t)));
 
   addFunc(ve,sumArray<T>,t1,SYM(sum),formal(t2,SYM(a)));
   addUnorderedOps<T>(ve,t1,t2,t3,t4);
@@ -618,7 +672,9 @@ void addArrayOps(venv &ve, types::array *t)
   // which may not be known at runtime.  Therefore, the depth, which is known
   // here at compile-time, is pushed on the stack beforehand by use of a
   // thunk.
-  callable *copyValueFunc = new thunk(new vm::bfunc(run::copyArrayValue),(Int) depth-1);
+  callable *copyValueFunc =
+    new thunk(new vm::bfunc(t->packed() ? run::copyPackedArrayValue :
+                            run::copyArrayValue),(Int) depth-1);
   addFunc(ve, new callableAccess(copyValueFunc),
           t, SYM(array), formal(primInt(), SYM(n)),
           formal(ct, SYM(value)),
@@ -640,6 +696,10 @@ void addArrayOps(venv &ve, types::array *t)
           formal(new function(primBoolean(), ct, ct), SYM(less)),
           formal(primBoolean(), SYM(stable), true));
 
+  addFunc(ve, run::arrayArgsort,
+          IntArray(), SYM(argsort), formal(t, SYM(a)),
+          formal(new function(primBoolean(), ct, ct), SYM(less)));
+
   switch (depth) {
     case 1:
       addRestFunc(ve, run::arrayConcat, t, SYM(concat), new types::array(t));
@@ -659,6 +719,21 @@ void addArrayOps(venv &ve, types::array *t)
   }
 }
 
+// Adds standard functions for a newly added map type.
+void addMapOps(venv &ve, types::map *t)
+{
+  static types::function aliasType(primBoolean(), primVoid(), primVoid());
+  aliasType.sig.formals[0].t = t;
+  aliasType.sig.formals[1].t = t;
+
+  if (ve.lookByType(SYM(alias), &aliasType))
+    return;
+
+  addFunc(ve, run::mapAlias,
+          primBoolean(), SYM(alias), formal(t, SYM(a)), formal(t, SYM(b)));
+  addFunc(ve, run::mapCopy, t, SYM(copy), formal(t, SYM(m)));
+}
+
 void addRecordOps(venv &ve, record *r)
 {
   addFunc(ve, run::boolMemEq, primBoolean(), SYM(alias), formal(r, SYM(a)),
@@ -677,7 +752,7 @@ void addFunctionOps(venv &ve, function *f)
 
 void addOperators(venv &ve)
 {
-  addSimpleOperator(ve,binaryOp<string,plus>,primString(),SYM_PLUS);
+  addPureOperator(ve,binaryOp<string,plus>,primString(),SYM_PLUS);
 
   addBooleanOps<bool,And>(ve,primBoolean(),SYM_AMPERSAND,booleanArray());
   addBooleanOps<bool,Or>(ve,primBoolean(),SYM_BAR,booleanArray());
@@ -704,10 +779,10 @@ void addOperators(venv &ve)
   addUnorderedOps<string>(ve,primString(),stringArray(),stringArray2(),
                           stringArray3());
 
-  addSimpleOperator(ve,binaryOp<pair,minbound>,primPair(),SYM(minbound));
-  addSimpleOperator(ve,binaryOp<pair,maxbound>,primPair(),SYM(maxbound));
-  addSimpleOperator(ve,binaryOp<triple,minbound>,primTriple(),SYM(minbound));
-  addSimpleOperator(ve,binaryOp<triple,maxbound>,primTriple(),SYM(maxbound));
+  addPureOperator(ve,binaryOp<pair,minbound>,primPair(),SYM(minbound));
+  addPureOperator(ve,binaryOp<pair,maxbound>,primPair(),SYM(maxbound));
+  addPureOperator(ve,binaryOp<triple,minbound>,primTriple(),SYM(minbound));
+  addPureOperator(ve,binaryOp<triple,maxbound>,primTriple(),SYM(maxbound));
   addBinOps<pair,minbound>(ve,primPair(),pairArray(),pairArray2(),pairArray3(),
                            SYM(minbound));
   addBinOps<pair,maxbound>(ve,primPair(),pairArray(),pairArray2(),pairArray3(),
@@ -727,8 +802,8 @@ void addOperators(venv &ve)
   addFunc(ve,arrayFunc2<pair,pair,conjugate>,pairArray2(),SYM(conj),
           formal(pairArray2(),SYM(a)));
 
-  addFunc(ve,binaryOp<Int,divide>,primReal(),SYM_DIVIDE,
-          formal(primInt(),SYM(a)),formal(primInt(),SYM(b)));
+  addPureFunc(ve,binaryOp<Int,divide>,primReal(),SYM_DIVIDE,
+              formal(primInt(),SYM(a)),formal(primInt(),SYM(b)));
   addFunc(ve,arrayOp<Int,Int,divide>,realArray(),SYM_DIVIDE,
           formal(IntArray(),SYM(a)),formal(primInt(),SYM(b)));
   addFunc(ve,opArray<Int,Int,divide>,realArray(),SYM_DIVIDE,
@@ -775,6 +850,18 @@ void openFunc(stack *Stack)
 }
 #endif
 
+void currentpenRead(stack *Stack)
+{
+  Stack->push(processData().currentpen);
+}
+
+void currentpenWrite(stack *Stack)
+{
+  pen p=vm::pop<pen>(Stack);
+  processData().currentpen=p;
+  Stack->push(p);
+}
+
 // A function accessible in asy code print the bytecode of a function.
 void printBytecode(stack *Stack)
 {
@@ -856,6 +943,8 @@ void base_venv(venv &ve)
   addWrite(ve,write<transform>,primTransform(),transformArray());
   addWrite(ve,write<guide *>,primGuide(),guideArray());
   addWrite(ve,write<pen>,primPen(),penArray());
+  addWrite(ve,write<camp::stringbuilder *>,primStringBuilder(),
+           stringbuilderArray());
   addFunc(ve,arrayArrayOp<pen,equals>,booleanArray(),SYM_EQ,
           formal(penArray(),SYM(a)),formal(penArray(),SYM(b)));
   addFunc(ve,arrayArrayOp<pen,notequals>,booleanArray(),SYM_NEQ,
@@ -881,7 +970,11 @@ void base_venv(venv &ve)
   addConstant<double>(ve, PI, primReal(), SYM(pi));
   addConstant<string>(ve, string(REVISION),primString(),SYM(VERSION));
 
-  addVariable<pen>(ve, &processData().currentpen, primPen(), SYM(currentpen));
+  // Translated modules are shared between files, so currentpen is looked up
+  // in the data of the file being run.
+  REGISTER_BLTIN(currentpenRead, "currentpenRead");
+  REGISTER_BLTIN(currentpenWrite, "currentpenWrite");
+  addVariable(ve, currentpenRead, currentpenWrite, primPen(), SYM(currentpen));
 
 #ifdef OPENFUNCEXAMPLE
   addOpenFunc(ve, openFunc, primInt(), SYM(openFunc));
@@ -895,6 +988,7 @@ void base_venv(venv &ve)
   gen_runlabel_venv(ve);
   gen_runhistory_venv(ve);
   gen_runarray_venv(ve);
+  gen_runmap_venv(ve);
   gen_runfile_venv(ve);
   gen_runsystem_venv(ve);
   gen_runstring_venv(ve);
@@ -961,6 +1055,8 @@ void arrayDeleteHelper(stack *Stack)
 
 // Used by coder to optimize conditional jumps.
 const bltin intLess = binaryOp<Int,less>;
+const bltin intLessEquals = binaryOp<Int,lessequals>;
+const bltin intGreaterEquals = binaryOp<Int,greaterequals>;
 const bltin intGreater = binaryOp<Int,greater>;
 
 }
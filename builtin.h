@@ -34,8 +34,23 @@ void addFunc(venv &ve, vm::bltin f, types::ty *result, symbol name,
              types::formal fF=noformal, types::formal fG=noformal,
              types::formal fH=noformal, types::formal fI=noformal);
 
+// Add a pure function, which has no side effects and returns a value that
+// depends only on its arguments.  Calls to it on constant arguments are
+// evaluated when the code is translated.
+void addPureFunc(venv &ve, vm::bltin f, types::ty *result, symbol name,
+                 types::formal f1=noformal, types::formal f2=noformal,
+                 types::formal f3=noformal, types::formal f4=noformal,
+                 types::formal f5=noformal, types::formal f6=noformal,
+                 types::formal f7=noformal, types::formal f8=noformal,
+                 types::formal f9=noformal, types::formal fA=noformal,
+                 types::formal fB=noformal, types::formal fC=noformal,
+                 types::formal fD=noformal, types::formal fE=noformal,
+                 types::formal fF=noformal, types::formal fG=noformal,
+                 types::formal fH=noformal, types::formal fI=noformal);
+
 // Adds standard functions for a newly added types.
 void addArrayOps(venv &ve, types::array *t);
+void addMapOps(venv &ve, types::map *t);
 void addRecordOps(venv &ve, types::record *r);
 void addFunctionOps(venv &ve, types::function *f);
 
@@ -54,6 +69,8 @@ void arrayDeleteHelper(vm::stack *Stack);
 
 // Used by to optimize conditional jumps.
 extern const vm::bltin intLess;
+extern const vm::bltin intLessEquals;
+extern const vm::bltin intGreaterEquals;
 extern const vm::bltin intGreater;
 }
 
@@ -7,6 +7,7 @@
 
 #include "stack.h"
 #include "callable.h"
+#include "sampler.h"
 
 namespace vm {
 
@@ -36,6 +37,12 @@ void func::print(ostream& out) {
 #endif
 }
 
+void bfunc::call(stack *s)
+{
+  sampledBuiltin sampled(func);
+  func(s);
+}
+
 bool bfunc::compare(callable* F)
 {
   if (bfunc* f=dynamic_cast<bfunc*>(F))
@@ -55,9 +55,11 @@ class bfunc : public callable
 {
 public:
   bfunc(bltin b) : func(b) {}
-  virtual void call (stack *s) { func(s); }
+  virtual void call (stack *s);
   virtual bool compare(callable*);
 
+  bltin getBuiltin() { return func; }
+
   void print(ostream& out);
 private:
   bltin func;
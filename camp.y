@@ -152,7 +152,7 @@ using mem::string;
 %type  <ip>  idpair stridpair
 %type  <ipl> idpairlist stridpairlist
 %type  <vd>  vardec barevardec 
-%type  <t>   type celltype
+%type  <t>   type celltype maptype
 %type  <dim> dims
 %type  <dil> decidlist
 %type  <di>  decid
@@ -297,6 +297,13 @@ celltype:
   name             { $$ = new nameTy($1); }
 ;
 
+maptype:
+  name '[' name ']'
+                   { $$ = new mapTy($2, new nameTy($1), new nameTy($3)); }
+| name dims '[' name ']'
+                   { $$ = new mapTy($3, new arrayTy($1, $2), new nameTy($4)); }
+;
+
 dims:
  '[' ']'           { $$ = new dimensions($1); }
 | dims '[' ']'     { $$ = $1; $$->increase(); }
@@ -402,6 +409,8 @@ fundec:
 typedec:
   STRUCT ID block  { $$ = new recorddec($1, $2.sym, $3); }
 | TYPEDEF vardec   { $$ = new typedec($1, $2); }
+| TYPEDEF maptype decidlist ';'
+                   { $$ = new typedec($1, new vardec($2->getPos(), $2, $3)); }
 ;
 
 slice:
@@ -14,6 +14,10 @@
 #include "genv.h"
 #include "entry.h"
 #include "builtin.h"
+#include "peephole.h"
+#include "escape.h"
+#include "fold.h"
+#include "settings.h"
 
 using namespace sym;
 using namespace types;
@@ -23,14 +27,13 @@ namespace trans {
 namespace {
 function *inittype();
 function *bootuptype();
+void markTailCalls(vm::program *code);
 }
 
 vm::lambda *newLambda(string name) {
   assert(!name.empty());
   vm::lambda *l = new vm::lambda;
-#ifdef DEBUG_FRAME
   l->name = name;
-#endif
   return l;
 }
 
@@ -52,7 +55,8 @@ coder::coder(position pos, string name, modifier sord)
     sord(sord),
     perm(DEFAULT_PERM),
     program(new vm::program),
-    curPos(pos)
+    curPos(pos),
+    labelled(0)
 {
   sord_stack.push(sord);
 }
@@ -73,7 +77,8 @@ coder::coder(position pos, string name, function *t, coder *parent,
     sord(sord),
     perm(DEFAULT_PERM),
     program(new vm::program),
-    curPos(pos)
+    curPos(pos),
+    labelled(0)
 {
   sord_stack.push(sord);
 }
@@ -91,7 +96,8 @@ coder::coder(position pos, record *t, coder *parent, modifier sord)
     sord(sord),
     perm(DEFAULT_PERM),
     program(new vm::program),
-    curPos(pos)
+    curPos(pos),
+    labelled(0)
 {
   sord_stack.push(sord);
 }
@@ -141,22 +147,7 @@ void coder::encodePop()
     parent->encodePop();
   }
   else {
-#ifdef COMBO
-    vm::program::label end = program->end();
-    --end;
-    inst& lastInst = *end;
-    if (lastInst.op == inst::varsave) {
-      lastInst.op = inst::varpop;
-      return;
-    }
-    if (lastInst.op == inst::fieldsave) {
-      lastInst.op = inst::fieldpop;
-      return;
-    }
-    // TODO: push+pop into no op.
-#endif
-
-    // No combo applicable.  Just encode a usual pop.
+    // Stores followed by pops are fused by the peephole optimizer.
     encode(inst::pop);
   }
 }
@@ -240,8 +231,19 @@ label coder::defLabel(label label)
   //cout << "defining label " << label << endl;
 
   assert(!label->location.defined());
+
+  // A jump to the instruction that follows it does nothing.
+  size_t here = program->size();
+  if (settings::fold && labelled < here && label->used() &&
+      !label->moreUses && label->firstUse == program->at(here-1) &&
+      program->back().op == inst::jmp) {
+    program->pop_back();
+    label->firstUse = vm::program::label();
+  }
+
   //vm::program::label here = program->end();
   label->location = program->end();
+  labelled = program->size();
   assert(label->location.defined());
 
   if (label->firstUse.defined()) {
@@ -267,6 +269,17 @@ void coder::useLabel(inst::opcode op, label label)
   if (isStatic())
     return parent->useLabel(op,label);
 
+  // A conditional jump on a constant either always or never jumps.
+  size_t size = program->size();
+  if (settings::fold && (op == inst::cjmp || op == inst::njmp) &&
+      size > labelled && program->back().op == inst::constpush) {
+    bool jumps = vm::get<bool>(program->back()) == (op == inst::cjmp);
+    program->pop_back();
+    if (!jumps)
+      return;
+    op = inst::jmp;
+  }
+
   if (label->location.defined()) {
     encode(op, label->location);
   } else {
@@ -298,13 +311,10 @@ label coder::fwdLabel()
   return l;
 }
 
-bool coder::usesClosureSinceLabel(label l)
+bool coder::closureEscapesSinceLabel(label l, Int firstLocal)
 {
   assert(l->location.defined());
-  for (vm::program::label i = l->location; i != program->end(); ++i)
-    if (i->op == inst::pushclosure)
-      return true;
-  return false;
+  return vm::frameEscapes(l->location, program->end(), firstLocal);
 }
 
 void coder::encodePatch(label from, label to)
@@ -318,6 +328,93 @@ void coder::encodePatch(label from, label to)
   from->location->ref = to->location;
 }
 
+bool coder::fold(const inst& i)
+{
+  if (!settings::fold)
+    return false;
+
+  vm::bltin f = vm::get<vm::bltin>(i);
+  Int arity = vm::pureArity(f);
+  if (arity < 0)
+    return false;
+
+  size_t n = (size_t) arity;
+  size_t size = program->size();
+  if (n > size || size-n < labelled)
+    return false;
+
+  mem::vector<item> args(n);
+  vm::program::label p = program->at(size-n);
+  for (size_t k = 0; k < n; ++k, ++p) {
+    switch (p->op) {
+      case inst::intpush:
+      case inst::constpush:
+        args[k] = p->ref;
+        break;
+      case inst::push_default:
+        args[k] = vm::Default;
+        break;
+      default:
+        return false;
+    }
+  }
+
+  item value;
+  if (!vm::foldCall(f, n ? &args[0] : 0, n, value))
+    return false;
+
+  for (size_t k = 0; k < n; ++k)
+    program->pop_back();
+
+  inst c; c.op = inst::constpush; c.pos = i.pos; c.ref = value;
+  program->encode(c);
+  return true;
+}
+
+bool coder::fallsThrough()
+{
+  if (isStatic())
+    return parent->fallsThrough();
+
+  size_t size = program->size();
+  return size == 0 || labelled == size || program->back().op != inst::jmp;
+}
+
+size_t coder::mark()
+{
+  if (isStatic())
+    return parent->mark();
+
+  return program->size();
+}
+
+bool coder::discardSince(size_t mark)
+{
+  if (isStatic())
+    return parent->discardSince(mark);
+
+  if (!settings::fold || labelled >= mark)
+    return false;
+
+  size_t size = program->size();
+  for (vm::program::label p = program->at(mark); p != program->end(); ++p)
+    switch (p->op) {
+      case inst::jmp:
+      case inst::cjmp:
+      case inst::njmp:
+      case inst::jump_if_not_default:
+      case inst::pushframe:
+      case inst::popframe:
+        return false;
+      default:
+        break;
+    }
+
+  for (; size > mark; --size)
+    program->pop_back();
+  return true;
+}
+
 void coder::markPos(position pos)
 {
   curPos = pos;
@@ -334,6 +431,20 @@ vm::lambda *coder::close() {
   if (funtype->result->kind == types::ty_void)
     encode(inst::ret);
 
+  // Escape analysis looks for patterns in the unoptimized code.
+  vm::assessClosure(l, program);
+
+  if (settings::optimize)
+    program = vm::peephole(program);
+
+  markTailCalls(program);
+
+  if (settings::dumpcode && program->begin() != program->end()) {
+    cout << program->begin()->pos << ":\n";
+    vm::print(cout, program);
+    cout << endl;
+  }
+
   l->code = program;
 
   l->parentIndex = level->parentIndex();
@@ -370,6 +481,25 @@ function *bootuptype()
   static function t(types::primVoid());
   return &t;
 }
+
+// A call that is followed by a return, possibly through jumps, returns the
+// value of the call, so the function called can run in place of the caller.
+void markTailCalls(vm::program *code)
+{
+  size_t n = code->size();
+  for (vm::program::label ip = code->begin(); ip != code->end(); ++ip) {
+    if (ip->op != inst::popcall)
+      continue;
+    vm::program::label next = ip;
+    ++next;
+    // Bound the search, in case of an infinite loop.
+    for (size_t steps = 0;
+         next != code->end() && next->op == inst::jmp && steps < n; ++steps)
+      next = vm::get<vm::program::label>(*next);
+    if (next != code->end() && next->op == inst::ret)
+      ip->op = inst::tailcall;
+  }
+}
 } // private
 
 } // namespace trans
@@ -53,6 +53,11 @@ struct label_t : public gc {
   // Only the constructor is defined.  Everything else is handles by methods
   // of the coder class.
   label_t() : location(), firstUse(), moreUses(0) {}
+
+  // Has a jump to the label been encoded?
+  bool used() const {
+    return firstUse.defined();
+  }
 };
 typedef label_t *label;
 
@@ -122,6 +127,11 @@ class coder {
   // Current File Position
   position curPos;
 
+  // The index of the instruction that the last label defined points to.  A
+  // jump may land on any label, so code is only rewritten from this index
+  // on, where it runs straight through.
+  size_t labelled;
+
 public:
   // Define a new function coder.  If reframe is true, this gives the function
   // its own frame, which is the usual (sensible) thing to do.  It is set to
@@ -272,11 +282,16 @@ private:
       assert(parent);
       parent->encode(i);
     }
-    else {
+    else if (i.op != inst::builtin || !fold(i)) {
       program->encode(i);
     }
   }
 
+  // If i calls a pure builtin whose arguments are all pushed by the
+  // instructions just encoded, replaces them by a push of the value the
+  // call returns.  Returns true if the call was folded.
+  bool fold(const inst& i);
+
   // Encode a jump to a not yet known location.
   vm::program::label encodeEmptyJump(inst::opcode op);
 
@@ -383,13 +398,27 @@ public:
     }
   }
 
-  // Returns true if a pushclosure has been encoded since the definition of
-  // the label.
-  bool usesClosureSinceLabel(label l);
+  // Returns true if the code encoded since the definition of the label may
+  // use the closure in a way that outlives the code, for instance by making
+  // a function that is stored elsewhere.  The variables the code declares
+  // are numbered from firstLocal on.
+  bool closureEscapesSinceLabel(label l, Int firstLocal);
 
   // Turn a no-op into a jump to bypass incorrect code.
   void encodePatch(label from, label to);
 
+  // Returns false if the next instruction encoded cannot be reached, as it
+  // follows an unconditional jump.
+  bool fallsThrough();
+
+  // Marks the current point in the code, for use by discardSince.
+  size_t mark();
+
+  // Removes the code encoded since the mark, which must not be reachable.
+  // Code that jumps, or that is jumped into, is kept.  Returns true if the
+  // code was removed.
+  bool discardSince(size_t mark);
+
 public:
   void encodePushFrame() {
     pushframeLabels.push(program->end());
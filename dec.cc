@@ -126,6 +126,59 @@ arrayTy::operator string() const
   return ss.str();
 }
 
+
+void mapTy::prettyprint(ostream &out, Int indent)
+{
+  prettyname(out, "mapTy",indent, getPos());
+
+  value->prettyprint(out, indent+1);
+  key->prettyprint(out, indent+1);
+}
+
+void mapTy::addOps(coenv &e, record *r)
+{
+  value->addOps(e, r);
+
+  types::ty *t=trans(e, true);
+  if (t->kind == types::ty_map) {
+    types::map *mt=dynamic_cast<types::map *>(t);
+    assert(mt);
+    e.e.addMapOps(mt);
+    if (r)
+      r->e.addMapOps(mt);
+  }
+}
+
+types::ty *mapTy::trans(coenv &e, bool tacit)
+{
+  types::ty *vt = value->trans(e, tacit);
+  types::ty *kt = key->trans(e, tacit);
+  if (vt->kind == types::ty_error || kt->kind == types::ty_error)
+    return primError();
+
+  if (!types::map::keyType(kt)) {
+    if (!tacit) {
+      em.error(getPos());
+      em << "cannot use type '" << *kt << "' as the key of a map";
+    }
+    return primError();
+  }
+  if (vt->kind == ty_void) {
+    if (!tacit) {
+      em.error(getPos());
+      em << "cannot declare map of type void";
+    }
+    return primError();
+  }
+
+  return new types::map(kt, vt);
+}
+
+mapTy::operator string() const
+{
+  return static_cast<string>(*value) + "[" + static_cast<string>(*key) + "]";
+}
+
 tyEntryTy::tyEntryTy(position pos, types::ty *t)
   : ty(pos), ent(new trans::tyEntry(t, 0, 0, position()))
 {
@@ -1029,6 +1082,7 @@ void includedec::loadFailed(coenv &)
 
 void includedec::transAsField(coenv &e, record *r)
 {
+  e.e.addInclude(filename);
   file *ast = parser::parseFile(filename,"Including");
   em.sync();
 
@@ -125,6 +125,27 @@ public:
   operator string() const override;
 };
 
+// The type of a map from keys of a primitive type to values, written as
+//   typedef value[key] name;
+// Map types may only be introduced by typedef, as value[key] would otherwise
+// be read as a subscript.
+class mapTy : public ty {
+  ty *value;
+  ty *key;
+
+public:
+  mapTy(position pos, ty *value, ty *key)
+    : ty(pos), value(value), key(key) {}
+
+  void prettyprint(ostream &out, Int indent) override;
+
+  void addOps(coenv &e, record *r) override;
+
+  types::ty *trans(coenv &e, bool tacit = false) override;
+
+  operator string() const override;
+};
+
 // Similar to varEntryExp, this helper class always translates to the same fixed
 // type.
 class tyEntryTy : public ty {
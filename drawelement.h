@@ -22,6 +22,7 @@
 #include "glrender.h"
 #include "arrayop.h"
 #include "material.h"
+#include "gcstats.h"
 
 namespace camp {
 
@@ -168,6 +169,25 @@ public:
 
   virtual ~drawElement() {}
 
+  // Elements are counted as they are allocated, with the size of the
+  // derived class.
+  void *operator new(size_t n) {
+    return operator new(n,UseGC);
+  }
+
+  void *operator new(size_t n, GCPlacement placement) {
+    mem::noteAllocation(mem::DRAWELEMENTS,n);
+    return ::operator new(n,placement);
+  }
+
+  void operator delete(void *p) {
+#ifdef USEGC
+    GC_FREE(p);
+#else
+    ::operator delete(p);
+#endif
+  }
+
   static mem::vector<triple> centers;
   static centerMap centermap;
   static size_t centerIndex;
@@ -72,9 +72,9 @@ public:
 
   void bounds(const double* t, bbox3& B) {
     if(t != NULL) {
-      const path3 tg(camp::transformed(t,g));
-      B.add(tg.min());
-      B.add(tg.max());
+      bbox3 b=g.bounds(t);
+      B.add(b.Min());
+      B.add(b.Max());
     } else {
       B.add(Min);
       B.add(Max);
@@ -133,7 +133,8 @@ void core_venv::initTable(size_t capacity) {
   this->capacity = capacity;
   size = 0;
   mask = capacity - 1;
-  table = new (UseGC) cell[capacity];
+  table = a ? (cell *) a->allocate(sizeof(cell) * capacity) :
+    new (UseGC) cell[capacity];
   memset(table, 0, sizeof(cell) * capacity);
 }
 
@@ -567,6 +568,9 @@ void venv::namevalue::popType(ty *s)
 void venv::remove(const addition& a) {
   CHECKNAME(a.name);
 
+  if (a.name == symbol::castsym)
+    ++castChanges;
+
   if (a.shadowed) {
     varEntry *popEnt = core.store(a.name, a.shadowed);
 
@@ -606,6 +610,7 @@ void venv::endScope() {
     // clear the hash tables to return to that state.
     core.clear();
     names.clear();
+    ++castChanges;
 
     assert(empty_scopes > 0);
     --empty_scopes;
@@ -646,6 +651,9 @@ void venv::enter(symbol name, varEntry *v)
 
   ty *t = v->getType();
 
+  if (name == symbol::castsym)
+    ++castChanges;
+
   // Record the addition, so it can be undone during endScope.
   if (!scopesizes.empty())
     additions.push(addition(name, t, shadowed));
@@ -13,6 +13,7 @@
 #include <iostream>
 
 #include "common.h"
+#include "arena.h"
 #include "frame.h"
 #include "table.h"
 #include "types.h"
@@ -255,6 +256,7 @@ private:
   size_t size;
   size_t mask;
   cell *table;
+  mem::arena *a;
 
   void initTable(size_t capacity);
 
@@ -272,7 +274,9 @@ private:
                                   symbol name, varEntry *ent);
 
 public:
-  core_venv(size_t capacity) {
+  // The table is allocated from the arena, if given.
+  core_venv(size_t capacity, mem::arena *a=0)
+    : a(a) {
     initTable(capacity);
   }
 
@@ -405,10 +409,14 @@ class venv {
   // current (possibly overloaded) type of the name.
   // The hash table implementation is slightly faster than the std::map binary
   // tree implementation, so we use it if we can.
+  typedef mem::arena_allocator<std::pair<const symbol, namevalue> >
+  namealloc;
 #ifdef NOHASH
-  typedef mem::map<symbol CONST, namevalue> namemap;
+  typedef std::map<symbol CONST, namevalue, std::less<symbol>, namealloc>
+  namemap;
 #else
-  typedef mem::unordered_map<symbol, namevalue, namehash, nameeq> namemap;
+  typedef std::unordered_map<symbol, namevalue, namehash, nameeq, namealloc>
+  namemap;
 #endif
   namemap names;
 
@@ -431,19 +439,28 @@ class venv {
 
   // The number of scopes begun (but not yet ended) when the venv was empty.
   size_t empty_scopes;
+
+  // Counts the changes to the implicit casts, which may change the result of
+  // overload resolution.
+  size_t castChanges;
 public:
   venv() :
-    core(1 << 2), empty_scopes(0) {}
+    core(1 << 2), empty_scopes(0), castChanges(0) {}
 
   // Most file level modules automatically import plain, so allocate hashtables
-  // big enough to hold it in advance.
+  // big enough to hold it in advance.  The environment of a module is not
+  // needed once the module is translated, so the hashtables are allocated
+  // from the arena of the module, if any.
   struct file_env_tag {};
   venv(file_env_tag)
-    : core(fileCoreSize),
-#ifndef NOHASH
-      names(fileNamesSize),
+    : core(fileCoreSize, mem::arena::current()),
+#ifdef NOHASH
+      names(std::less<symbol>(), namealloc(mem::arena::current())),
+#else
+      names(fileNamesSize, namehash(), nameeq(),
+            namealloc(mem::arena::current())),
 #endif
-      empty_scopes(0) {}
+      empty_scopes(0), castChanges(0) {}
 
   // Add a new variable definition.
   void enter(symbol name, varEntry *v);
@@ -482,6 +499,11 @@ public:
   // particular name.
   ty *getType(symbol name);
 
+  // Changes whenever an implicit cast is added or removed.
+  size_t castGeneration() const {
+    return castChanges;
+  }
+
   void beginScope();
   void endScope();
 
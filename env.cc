@@ -186,6 +186,11 @@ void protoenv::addArrayOps(array *a)
   trans::addArrayOps(ve, a);
 }
 
+void protoenv::addMapOps(types::map *m)
+{
+  trans::addMapOps(ve, m);
+}
+
 void protoenv::addRecordOps(record *r)
 {
   trans::addRecordOps(ve, r);
@@ -197,7 +202,7 @@ void protoenv::addFunctionOps(function *f)
 }
 
 env::env(genv &ge)
-  : protoenv(venv::file_env_tag()), ge(ge)
+  : protoenv(venv::file_env_tag()), ge(ge), resolutions(0)
 {
   // NOTE: May want to make this initial environment into a "builtin" module,
   // and then import the builtin module.
@@ -214,4 +219,9 @@ record *env::getModule(symbol id, string filename)
   return ge.getModule(id, filename);
 }
 
+void env::addInclude(string filename)
+{
+  ge.addInclude(filename);
+}
+
 }
@@ -26,6 +26,7 @@ using types::function;
 using types::record;
 
 class genv;
+class resolutionCache;
 
 // Keeps track of the name bindings of variables and types.  This is used for
 // the fields of a record, whereas the derived class env is used for unqualified
@@ -146,6 +147,7 @@ public:
 
   // Add the standard functions for a new type.
   void addArrayOps(types::array *t);
+  void addMapOps(types::map *t);
   void addRecordOps(types::record *r);
   void addFunctionOps(types::function *f);
 
@@ -174,12 +176,17 @@ class env : public protoenv {
   // The global environment - keeps track of modules.
   genv &ge;
 public:
+  // The results of overload resolution, kept by multimatch.
+  resolutionCache *resolutions;
+
   // Start an environment for a file-level module.
   env(genv &ge);
 
   ~env();
 
   record *getModule(symbol id, string filename);
+
+  void addInclude(string filename);
 };
 
 } // namespace trans
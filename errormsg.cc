@@ -59,6 +59,10 @@ void errorstream::clear()
 
 void errorstream::message(position pos, const string& s)
 {
+  if (muted) {
+    ++discarded;
+    return;
+  }
   if (floating) out << endl;
   out << pos << s;
   floating = true;
@@ -67,43 +71,43 @@ void errorstream::message(position pos, const string& s)
 void errorstream::compiler(position pos)
 {
   message(pos,"compiler: ");
-  anyErrors = true;
+  if (!muted) anyErrors = true;
 }
 
 void errorstream::compiler()
 {
   message(nullPos,"compiler: ");
-  anyErrors = true;
+  if (!muted) anyErrors = true;
 }
 
 void errorstream::runtime(position pos)
 {
   message(pos,"runtime: ");
-  anyErrors = true;
+  if (!muted) anyErrors = true;
 }
 
 void errorstream::error(position pos)
 {
   message(pos,"");
-  anyErrors = true;
+  if (!muted) anyErrors = true;
 }
 
 void errorstream::warning(position pos, string s)
 {
   message(pos,"warning ["+s+"]: ");
-  anyWarnings = true;
+  if (!muted) anyWarnings = true;
 }
 
 void errorstream::warning(position pos)
 {
   message(pos,"warning: ");
-  anyWarnings = true;
+  if (!muted) anyWarnings = true;
 }
 
 void errorstream::fatal(position pos)
 {
   message(pos,"abort: ");
-  anyErrors = true;
+  if (!muted) anyErrors = true;
 }
 
 void errorstream::trace(position pos)
@@ -123,6 +127,7 @@ void errorstream::cont()
 
 void errorstream::sync()
 {
+  if (muted) return;
   if (floating) out << endl;
   floating = false;
 }
@@ -34,7 +34,7 @@ public:
     return lineNum;
   }
 
-  string name() const {
+  const string& name() const {
     return filename;
   }
 
@@ -171,16 +171,34 @@ class errorstream {
   // Is there an error that warrants the asy process to return 1 instead of 0?
   bool anyStatusErrors;
 
+  size_t muted;         // Nesting depth of mute() calls.
+  size_t discarded;     // Number of messages discarded while muted.
+
 public:
   static bool interrupt; // Is there a pending interrupt?
 
   errorstream(ostream& out = cerr)
     : out(out), anyErrors(false), anyWarnings(false), floating(false),
-      anyStatusErrors(false) {}
+      anyStatusErrors(false), muted(0), discarded(0) {}
 
 
   void clear();
 
+  // While muted, messages are discarded and do not count as errors or
+  // warnings.  This is used when code is run speculatively during
+  // translation, where a failure only means the code must run later.
+  void mute() {
+    ++muted;
+  }
+
+  void unmute() {
+    --muted;
+  }
+
+  size_t discardedMessages() const {
+    return discarded;
+  }
+
   void message(position pos, const string& s);
 
   void Interrupt(bool b) {
@@ -215,8 +233,10 @@ public:
   // NOTE: May later make it do automatic line breaking for long messages.
   template<class T>
   errorstream& operator << (const T& x) {
-    flush(out);
-    out << x;
+    if (!muted) {
+      flush(out);
+      out << x;
+    }
     return *this;
   }
 
@@ -235,7 +255,7 @@ public:
   }
 
   void statusError() {
-    anyStatusErrors=true;
+    if (!muted) anyStatusErrors=true;
   }
 
   // Returns true if no errors have occured that should be reported by the
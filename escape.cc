@@ -0,0 +1,204 @@
+/*****
+ * escape.cc
+ *
+ * Escape analysis of the frames of functions.  A function whose frame
+ * cannot outlive the call runs in a frame that the stack reuses, rather than
+ * one allocated on the heap for each call.
+ *****/
+
+#include <algorithm>
+
+#include "escape.h"
+
+namespace vm {
+
+namespace {
+
+typedef mem::vector<Int> slots_t;
+
+inline bool holdsClosure(const slots_t& slots, Int n)
+{
+  return std::find(slots.begin(), slots.end(), n) != slots.end();
+}
+
+inline bool isCall(inst::opcode op)
+{
+  return op == inst::popcall || op == inst::tailcall;
+}
+
+// A function closing over the frame uses the variable n of the frame at ip:
+// a function made with the frame may only be called.
+bool fieldUseEscapes(program::label ip, program::label end,
+                     const slots_t& slots, Int n)
+{
+  if (!holdsClosure(slots, n))
+    return false;
+  ++ip;
+  return ip == end || !isCall(ip->op);
+}
+
+// Returns true if f, made to close over the frame, can make the frame
+// outlive the call of f.
+bool linkEscapes(lambda *f, const slots_t& slots)
+{
+  // A function that needs a closure of its own could store its frame, and
+  // with it the link, anywhere.
+  if (f->closureReq != lambda::DOESNT_NEED_CLOSURE)
+    return true;
+
+  Int link = (Int) f->parentIndex;
+  program::label end = f->code->end();
+  for (program::label ip = f->code->begin(); ip != end; ++ip) {
+    switch (ip->op) {
+      case inst::varpush: {
+        if (get<Int>(*ip) != link)
+          break;
+        program::label next = ip;
+        ++next;
+        if (next == end)
+          return true;
+        if (next->op == inst::fieldsave || next->op == inst::fieldpop)
+          break;
+        if (next->op != inst::fieldpush ||
+            fieldUseEscapes(next, end, slots, get<Int>(*next)))
+          return true;
+        break;
+      }
+
+      case inst::varfieldpush: {
+        Int n = get<Int>(*ip);
+        if (firstOperand(n) == link &&
+            fieldUseEscapes(ip, end, slots, secondOperand(n)))
+          return true;
+        break;
+      }
+
+      case inst::varpush2: {
+        Int n = get<Int>(*ip);
+        if (firstOperand(n) == link || secondOperand(n) == link)
+          return true;
+        break;
+      }
+
+      case inst::varsave:
+      case inst::varpop:
+      case inst::varpush_builtin:
+        if (get<Int>(*ip) == link)
+          return true;
+        break;
+
+      default:
+        break;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+bool frameEscapes(program::label begin, program::label end, Int firstLocal)
+{
+  // The variables holding functions made with the frame, the functions, and
+  // the instructions storing them.
+  slots_t slots;
+  mem::vector<lambda *> made;
+  mem::vector<program::label> stores;
+
+  for (program::label ip = begin; ip != end; ++ip) {
+    if (ip->op == inst::pushframe)
+      return true;
+    if (ip->op != inst::pushclosure)
+      continue;
+
+    // The frame may only be used as the closure of a function that is
+    // immediately stored in a variable.
+    program::label make = ip;
+    if (++make == end || make->op != inst::makefunc)
+      return true;
+    program::label store = make;
+    if (++store == end)
+      return true;
+    if (store->op == inst::varsave) {
+      program::label pop = store;
+      if (++pop == end || pop->op != inst::pop)
+        return true;
+    }
+    else if (store->op != inst::varpop)
+      return true;
+
+    // Variables declared before the code may be used after it.
+    Int slot = get<Int>(*store);
+    if (slot < firstLocal)
+      return true;
+
+    slots.push_back(slot);
+    made.push_back(get<lambda *>(*make));
+    stores.push_back(store);
+  }
+
+  if (slots.empty())
+    return false;
+
+  // The functions may only be called.
+  for (program::label ip = begin; ip != end; ++ip) {
+    switch (ip->op) {
+      case inst::varpush:
+        if (holdsClosure(slots, get<Int>(*ip))) {
+          program::label next = ip;
+          if (++next == end || !isCall(next->op))
+            return true;
+        }
+        break;
+
+      case inst::varsave:
+      case inst::varpop:
+        if (holdsClosure(slots, get<Int>(*ip)) &&
+            std::find(stores.begin(), stores.end(), ip) == stores.end())
+          return true;
+        break;
+
+      case inst::varpush_builtin:
+        if (holdsClosure(slots, get<Int>(*ip)))
+          return true;
+        break;
+
+      case inst::varpush2:
+      case inst::varfieldpush: {
+        Int n = get<Int>(*ip);
+        if (holdsClosure(slots, firstOperand(n)) ||
+            (ip->op == inst::varpush2 &&
+             holdsClosure(slots, secondOperand(n))))
+          return true;
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+
+  for (size_t i = 0; i < made.size(); ++i)
+    if (linkEscapes(made[i], slots))
+      return true;
+
+  return false;
+}
+
+void assessClosure(lambda *l, program *code)
+{
+  bool usesFrame = false;
+  for (program::label ip = code->begin(); ip != code->end(); ++ip)
+    if (ip->op == inst::pushclosure || ip->op == inst::pushframe) {
+      usesFrame = true;
+      break;
+    }
+
+  if (!usesFrame)
+    l->closureReq = lambda::DOESNT_NEED_CLOSURE;
+  else if (frameEscapes(code->begin(), code->end()))
+    l->closureReq = lambda::NEEDS_CLOSURE;
+  else
+    l->closureReq = lambda::SCOPED_CLOSURE;
+}
+
+} // namespace vm
@@ -0,0 +1,28 @@
+/*****
+ * escape.h
+ *
+ * Escape analysis of the frames of functions.
+ *****/
+
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#include "program.h"
+
+namespace vm {
+
+// Returns true if the frame in which the code in [begin, end) runs may still
+// be referred to once that code has finished.  This is conservative: the
+// frame is known not to escape only if its sole uses are to make functions
+// that are stored in its variables numbered from firstLocal on and called
+// directly, and those functions need no closure of their own and only use
+// their link to the frame to access its variables.
+bool frameEscapes(program::label begin, program::label end,
+                  Int firstLocal=0);
+
+// Decides the closure requirement of a function from its unoptimized code.
+void assessClosure(lambda *l, program *code);
+
+} // namespace vm
+
+#endif
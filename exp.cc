@@ -13,6 +13,7 @@
 #include "runmath.h"
 #include "runpicture.h"
 #include "runarray.h"
+#include "runmap.h"
 #include "runpair.h"
 #include "runtriple.h"
 #include "runpath.h"
@@ -304,8 +305,23 @@ void subscriptExp::prettyprint(ostream &out, Int indent)
   index->prettyprint(out, indent+1);
 }
 
+types::map *subscriptExp::getMapType(coenv &e)
+{
+  types::ty *t = set->cgetType(e);
+  if (t->kind == ty_overloaded)
+    t = ((overloaded *)t)->signatureless();
+  return t && t->kind == ty_map ? (types::map *)t : 0;
+}
+
 types::ty *subscriptExp::trans(coenv &e)
 {
+  if (types::map *m = getMapType(e)) {
+    set->transAsType(e, m);
+    index->transToType(e, m->key);
+    e.c.encode(inst::builtin, run::mapRead);
+    return m->value;
+  }
+
   array *a = transArray(e);
   if (!a)
     return primError();
@@ -326,6 +342,9 @@ types::ty *subscriptExp::trans(coenv &e)
 
 types::ty *subscriptExp::getType(coenv &e)
 {
+  if (types::map *m = getMapType(e))
+    return m->value;
+
   array *a = getArrayType(e);
   return a ? (isAnArray(e, index) ? a : a->celltype) :
     primError();
@@ -333,6 +352,20 @@ types::ty *subscriptExp::getType(coenv &e)
 
 void subscriptExp::transWrite(coenv &e, types::ty *t, exp *value)
 {
+  if (types::map *m = getMapType(e)) {
+    set->transAsType(e, m);
+    if (!equivalent(m->value, t)) {
+      em.error(getPos());
+      em << "map expression cannot be used as an address";
+      value->transToType(e, t);
+      return;
+    }
+    index->transToType(e, m->key);
+    value->transToType(e, t);
+    e.c.encode(inst::builtin, run::mapWrite);
+    return;
+  }
+
   // Put array, index, and value on the stack in that order, then call
   // arrayWrite.
   array *a = transArray(e);
@@ -356,6 +389,18 @@ void subscriptExp::transWrite(coenv &e, types::ty *t, exp *value)
   e.c.encode(inst::builtin, run::arrayWrite);
 }
 
+exp *subscriptExp::evaluate(coenv &e, types::ty *)
+{
+  if (types::map *m = getMapType(e))
+    return new subscriptExp(getPos(),
+                            new tempExp(e, set, m),
+                            new tempExp(e, index, m->key));
+
+  return new subscriptExp(getPos(),
+                          new tempExp(e, set, getArrayType(e)),
+                          new tempExp(e, index, types::primInt()));
+}
+
 
 void slice::prettyprint(ostream &out, Int indent)
 {
@@ -416,6 +416,9 @@ public:
 class subscriptExp : public arrayExp {
   exp *index;
 
+  // The type of set if it is a map, which is subscripted by its keys.
+  types::map *getMapType(coenv &e);
+
 public:
   subscriptExp(position pos, exp *set, exp *index)
     : arrayExp(pos, set), index(index) {}
@@ -426,11 +429,7 @@ public:
   types::ty *getType(coenv &e);
   void transWrite(coenv &e, types::ty *t, exp *value);
 
-  exp *evaluate(coenv &e, types::ty *) {
-    return new subscriptExp(getPos(),
-                            new tempExp(e, set, getArrayType(e)),
-                            new tempExp(e, index, types::primInt()));
-  }
+  exp *evaluate(coenv &e, types::ty *);
 };
 
 class slice : public absyn {
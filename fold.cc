@@ -0,0 +1,81 @@
+/*****
+ * fold.cc
+ *
+ * Evaluation of calls to pure built-in functions on constant arguments while
+ * the code is translated.  The coder replaces such a call, and the
+ * instructions pushing its arguments, by a push of the value.
+ *****/
+
+#include "fold.h"
+#include "stack.h"
+#include "fpu.h"
+
+namespace vm {
+
+namespace {
+
+struct bltinHash {
+  size_t operator()(bltin f) const {
+    return (size_t) f;
+  }
+};
+
+typedef mem::unordered_map<bltin, size_t, bltinHash> arities_t;
+
+arities_t& arities()
+{
+  static arities_t *a=new arities_t;
+  return *a;
+}
+
+} // namespace
+
+void markPure(bltin f, size_t n)
+{
+  arities()[f]=n;
+}
+
+Int pureArity(bltin f)
+{
+  arities_t::iterator p=arities().find(f);
+  return p == arities().end() ? -1 : (Int) p->second;
+}
+
+bool foldCall(bltin f, const item *args, size_t n, item& result)
+{
+  stack s;
+  for (size_t i=0; i < n; ++i)
+    s.push(args[i]);
+
+  size_t discarded=em.discardedMessages();
+  bool folded=true;
+
+#ifdef HAVE_FEENABLEEXCEPT
+  // Run without trapping, then check the flags the call raised: the value of
+  // an invalid operation is left for the code to compute, so that it fails
+  // or not at run time as it would without folding.
+  fenv_t env;
+  feholdexcept(&env);
+#endif
+
+  em.mute();
+  try {
+    f(&s);
+    result=s.pop();
+  } catch (handled_error const&) {
+    folded=false;
+  } catch (bad_item_value const&) {
+    folded=false;
+  }
+  em.unmute();
+
+#ifdef HAVE_FEENABLEEXCEPT
+  if (fetestexcept(fpu_exceptions()))
+    folded=false;
+  fesetenv(&env);
+#endif
+
+  return folded && em.discardedMessages() == discarded;
+}
+
+} // namespace vm
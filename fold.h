@@ -0,0 +1,32 @@
+/*****
+ * fold.h
+ *
+ * Evaluation of calls to pure built-in functions on constant arguments while
+ * the code is translated.
+ *****/
+
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "vm.h"
+#include "item.h"
+
+namespace vm {
+
+// Records that the builtin f, which takes n arguments, has no side effects
+// and returns a value, of a type with value semantics, that depends only on
+// its arguments.
+void markPure(bltin f, size_t n);
+
+// Returns the number of arguments of f if it is pure, or -1 otherwise.
+Int pureArity(bltin f);
+
+// Calls the pure builtin f on the n arguments in args, storing its value in
+// result.  Returns false, and leaves no trace, if f reports an error, a
+// warning, or raises a floating-point exception; the call must then be left
+// until the code is run.
+bool foldCall(bltin f, const item *args, size_t n, item& result);
+
+} // namespace vm
+
+#endif
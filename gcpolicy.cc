@@ -0,0 +1,115 @@
+/*****
+ * gcpolicy.cc
+ *
+ * Named policies for the garbage collector.
+ *****/
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "gcpolicy.h"
+
+namespace mem {
+
+namespace {
+
+struct gcPolicy {
+  const char *name;
+
+  // The free space divisor: the collector collects once the heap has grown
+  // by 1/divisor of its size, so a smaller divisor trades a larger heap for
+  // fewer collections.
+  size_t divisor;
+
+  // The size to which the heap is expanded in advance.
+  size_t heap;
+
+  // Whether to return free memory to the system after a full collection.
+  bool unmap;
+
+  // Whether to mark with a thread for each core.
+  bool parallel;
+};
+
+const gcPolicy policies[]={
+  {"default",2,0,false,false},
+  {"throughput",1,256 << 20,false,false},
+  {"footprint",6,0,true,false},
+  {"parallel",2,0,false,true}
+};
+
+const size_t numPolicies=sizeof(policies)/sizeof(gcPolicy);
+
+const gcPolicy *policyNamed(const char *name)
+{
+  for(size_t i=0; i < numPolicies; ++i)
+    if(strcmp(name,policies[i].name) == 0)
+      return policies+i;
+  return 0;
+}
+
+#ifdef USEGC
+// Expands the heap to at least n bytes.
+void expandHeap(size_t n)
+{
+  size_t size=GC_get_heap_size();
+  if(size < n)
+    GC_expand_hp(n-size);
+}
+#endif
+
+} // namespace
+
+bool gcPolicyNamed(const string& name)
+{
+  return policyNamed(name.c_str()) != 0;
+}
+
+void preinitGCPolicy()
+{
+#if defined(USEGC) && defined(HAVE_PTHREAD) &&                          \
+  (GC_VERSION_MAJOR > 8 || (GC_VERSION_MAJOR == 8 && GC_VERSION_MINOR >= 2))
+  const char *name=getenv("ASYMPTOTE_GCPOLICY");
+  const gcPolicy *p=name ? policyNamed(name) : 0;
+  if(p && p->parallel)
+    GC_set_markers_count(std::thread::hardware_concurrency());
+#endif
+}
+
+bool setGCPolicy(const string& name)
+{
+  const gcPolicy *p=policyNamed(name.c_str());
+  if(!p)
+    return false;
+#ifdef USEGC
+  GC_set_free_space_divisor((GC_word) p->divisor);
+  GC_set_force_unmap_on_gcollect(p->unmap);
+  expandHeap(p->heap);
+  return !p->parallel || GC_get_parallel() > 0;
+#else
+  return !p->parallel;
+#endif
+}
+
+void presizeHeap(const string& file)
+{
+#ifdef USEGC
+  std::ifstream in(file.c_str());
+  size_t peak;
+  if(in >> peak)
+    expandHeap(peak);
+#endif
+}
+
+void recordPeakHeap(const string& file)
+{
+#ifdef USEGC
+  std::ofstream out(file.c_str());
+  if(out)
+    out << GC_get_heap_size() << std::endl;
+#endif
+}
+
+} // namespace mem
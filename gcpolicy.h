@@ -0,0 +1,35 @@
+/*****
+ * gcpolicy.h
+ *
+ * Named policies trading the speed of the garbage collector against the size
+ * of the heap, and sizing of the heap to the peak of a previous run.
+ *****/
+
+#ifndef GCPOLICY_H
+#define GCPOLICY_H
+
+#include "common.h"
+
+namespace mem {
+
+// Whether there is a policy of the given name: default, throughput,
+// footprint, or parallel.
+bool gcPolicyNamed(const string& name);
+
+// Prepares the collector for the policy named by ASYMPTOTE_GCPOLICY, if any.
+// The number of marker threads can only be set before the collector is
+// initialized, which is done before the options are read.
+void preinitGCPolicy();
+
+// Applies the named policy.  Returns false if the policy could not be fully
+// applied, as when parallel marking is not available.
+bool setGCPolicy(const string& name);
+
+// Expands the heap to the peak recorded in the given file, if any, and
+// records the peak of this run there.
+void presizeHeap(const string& file);
+void recordPeakHeap(const string& file);
+
+} // namespace mem
+
+#endif
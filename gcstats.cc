@@ -0,0 +1,170 @@
+/*****
+ * gcstats.cc
+ *
+ * Telemetry of the garbage collector.
+ *****/
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+
+#include "common.h"
+#include "gcstats.h"
+
+namespace mem {
+
+allocCount allocations[NUMALLOCKINDS];
+std::atomic<bool> countAllocations(false);
+
+namespace {
+
+const char *allocKindNames[NUMALLOCKINDS]={
+  "boxes","frames","arrays","drawelements","paths"
+};
+
+const char *phaseNames[NUMPHASES]={
+  "startup","parse","translate","run","shipout","render"
+};
+
+phase current=STARTUP;
+
+// The bytes charged to each phase, and the total allocated when the bytes
+// were last charged.
+size_t phaseBytes[NUMPHASES];
+size_t mark=0;
+
+typedef std::chrono::steady_clock gcclock;
+gcclock::time_point collectionStart;
+double pauseSeconds=0.0;
+
+size_t totalBytes()
+{
+#ifdef USEGC
+  return GC_get_total_bytes();
+#else
+  return 0;
+#endif
+}
+
+// Charges the bytes allocated since the last charge to the current phase.
+void charge()
+{
+  size_t now=totalBytes();
+  phaseBytes[current] += now-mark;
+  mark=now;
+}
+
+#ifdef USEGC
+// Called by the collector, which holds its lock, at each stage of a
+// collection.
+void onCollection(GC_EventType e)
+{
+  if(e == GC_EVENT_START)
+    collectionStart=gcclock::now();
+  else if(e == GC_EVENT_END)
+    pauseSeconds += std::chrono::duration<double>(gcclock::now()-
+                                                  collectionStart).count();
+}
+#endif
+
+} // namespace
+
+phaseScope::phaseScope(phase p)
+  : saved(current)
+{
+  charge();
+  current=p;
+}
+
+phaseScope::~phaseScope()
+{
+  charge();
+  current=saved;
+}
+
+void startGCStats()
+{
+#ifdef USEGC
+  GC_set_on_collection_event(onCollection);
+#endif
+}
+
+const char *allocKindName(allocKind k)
+{
+  return allocKindNames[k];
+}
+
+const char *phaseName(phase p)
+{
+  return phaseNames[p];
+}
+
+allocKind allocKindNamed(const char *name)
+{
+  size_t k=0;
+  while(k < NUMALLOCKINDS && strcmp(name,allocKindNames[k]) != 0)
+    ++k;
+  return (allocKind) k;
+}
+
+phase phaseNamed(const char *name)
+{
+  size_t p=0;
+  while(p < NUMPHASES && strcmp(name,phaseNames[p]) != 0)
+    ++p;
+  return (phase) p;
+}
+
+size_t heapSize()
+{
+#ifdef USEGC
+  return GC_get_heap_size();
+#else
+  return 0;
+#endif
+}
+
+size_t collections()
+{
+#ifdef USEGC
+  return GC_get_gc_no();
+#else
+  return 0;
+#endif
+}
+
+double pauseTime()
+{
+  return pauseSeconds;
+}
+
+size_t allocated(phase p)
+{
+  charge();
+  return phaseBytes[p];
+}
+
+size_t allocated()
+{
+  return totalBytes();
+}
+
+void reportGCStats(std::ostream& out)
+{
+  charge();
+  out << "Heap size: " << heapSize() << " bytes" << std::endl
+      << "Collections: " << collections() << ", paused "
+      << pauseTime() << " s" << std::endl
+      << "Allocated: " << allocated() << " bytes" << std::endl;
+  for(size_t p=0; p < NUMPHASES; ++p)
+    out << "  " << std::left << std::setw(14) << phaseNames[p]
+        << std::right << std::setw(14) << phaseBytes[p] << " bytes"
+        << std::endl;
+  out << "Allocations by kind:" << std::endl;
+  for(size_t k=0; k < NUMALLOCKINDS; ++k)
+    out << "  " << std::left << std::setw(14) << allocKindNames[k]
+        << std::right << std::setw(14) << allocations[k].bytes.load()
+        << " bytes in " << allocations[k].count.load() << std::endl;
+}
+
+} // namespace mem
@@ -0,0 +1,95 @@
+/*****
+ * gcstats.h
+ *
+ * Telemetry of the garbage collector: the size of the heap, the number and
+ * total pause time of collections, the bytes allocated in each phase of a
+ * run, and the objects allocated of the kinds that dominate the heap.
+ *****/
+
+#ifndef GCSTATS_H
+#define GCSTATS_H
+
+#include <atomic>
+#include <iostream>
+
+namespace mem {
+
+// The kinds of objects whose allocations are counted.
+enum allocKind {
+  BOXES,        // values boxed by items
+  FRAMES,       // activation records of the virtual machine
+  ARRAYS,       // storage of asy arrays and maps
+  DRAWELEMENTS, // elements of pictures
+  PATHS,        // knots of paths and 3D paths
+  NUMALLOCKINDS
+};
+
+// The counts are atomic, as threads such as those intersecting arrays of
+// paths allocate too.
+struct allocCount {
+  std::atomic<size_t> count;
+  std::atomic<size_t> bytes;
+};
+
+extern allocCount allocations[NUMALLOCKINDS];
+
+// Whether allocations are counted: only once -gcstats is given or the counts
+// are first asked for, so that otherwise allocation pays just for the test.
+extern std::atomic<bool> countAllocations;
+
+inline void noteAllocation(allocKind k, size_t bytes)
+{
+  if(countAllocations.load(std::memory_order_relaxed)) {
+    allocCount& a=allocations[k];
+    a.count.fetch_add(1,std::memory_order_relaxed);
+    a.bytes.fetch_add(bytes,std::memory_order_relaxed);
+  }
+}
+
+// The phases of a run to which allocated bytes are charged.
+enum phase {
+  STARTUP,
+  PARSE,
+  TRANSLATE,
+  RUN,
+  SHIPOUT,
+  RENDER,
+  NUMPHASES
+};
+
+// While in scope, allocations are charged to the given phase; the phase in
+// effect before is resumed at the end of the scope.
+class phaseScope {
+  phase saved;
+public:
+  phaseScope(phase p);
+  ~phaseScope();
+};
+
+// Starts timing collections; called once the collector is initialized.
+void startGCStats();
+
+const char *allocKindName(allocKind k);
+const char *phaseName(phase p);
+
+// The kind or phase of the given name, or NUMALLOCKINDS or NUMPHASES if
+// there is none.
+allocKind allocKindNamed(const char *name);
+phase phaseNamed(const char *name);
+
+size_t heapSize();
+size_t collections();
+
+// The total time spent in collections, in seconds.
+double pauseTime();
+
+// The bytes allocated in the given phase, or in all.
+size_t allocated(phase p);
+size_t allocated();
+
+// Writes a report of all of the above.
+void reportGCStats(std::ostream& out);
+
+} // namespace mem
+
+#endif
@@ -14,6 +14,7 @@
  *****/
 
 #include <sstream>
+#include <fstream>
 #include <unistd.h>
 #include <algorithm>
 
@@ -28,6 +29,8 @@
 #include "locate.h"
 #include "interact.h"
 #include "builtin.h"
+#include "arena.h"
+#include "gcstats.h"
 
 using namespace types;
 using settings::getSetting;
@@ -38,6 +41,79 @@ types::record *transExternalModule(trans::genv& ge, string filename, symbol id);
 
 namespace trans {
 
+// A file as it was when a module was translated from it.
+struct source {
+  string name;
+  string path;
+  unsigned long long hash;
+};
+
+// Locates a file and hashes its contents, returning false if the file cannot
+// be read.
+static bool stamp(const string& name, source& s)
+{
+  if(name == "-" || parser::isURL(name))
+    return false;
+
+  s.name=name;
+  s.path=settings::locateFile(name);
+  if(s.path.empty())
+    return false;
+
+  std::ifstream in(s.path.c_str(),std::ios::binary);
+  if(!in)
+    return false;
+
+  // 64-bit FNV-1a.
+  unsigned long long h=14695981039346656037ULL;
+  char buf[8192];
+  while(in.read(buf,sizeof(buf)) || in.gcount() > 0) {
+    for(std::streamsize i=0, n=in.gcount(); i < n; ++i) {
+      h ^= (unsigned char) buf[i];
+      h *= 1099511628211ULL;
+    }
+  }
+  s.hash=h;
+  return true;
+}
+
+// The version and the settings that affect the translation of a module.
+static string translationKey()
+{
+  ostringstream key;
+  key << REVISION << " " << settings::optimize << " " << settings::fold
+      << " " << getSetting<bool>("autoplain");
+  return key.str();
+}
+
+struct cachedModule : public gc {
+  struct import {
+    symbol id;
+    string filename;
+    record *r;
+  };
+
+  string key;
+  bool cacheable;
+  record *r;
+  mem::list<source> sources;
+  mem::list<import> imports;
+
+  cachedModule()
+    : key(translationKey()), cacheable(settings::cachemodules), r(0) {}
+
+  void addSource(const string& name) {
+    source s;
+    if(cacheable && stamp(name,s))
+      sources.push_back(s);
+    else
+      cacheable=false;
+  }
+};
+
+typedef mem::map<CONST string,cachedModule *> moduleCache_t;
+static moduleCache_t moduleCache;
+
 genv::genv()
   : imap()
 {
@@ -72,20 +148,79 @@ record *genv::loadModule(symbol id, string filename) {
   }
 #endif
 
+  // Stamp the file before parsing it, so that a change made while it is
+  // being translated invalidates the translation.
+  cachedModule *c=new cachedModule;
+  c->addSource(filename);
+
   // Get the abstract syntax tree.
   absyntax::file *ast = parser::parseFile(filename,"Loading");
 
   inTranslation.push_front(filename);
+  building.push_front(c);
 
   em.sync();
 
-  record *r=ast->transAsFile(*this, id);
+  // The applications and the environment used to translate the module are
+  // dead once it is translated, so they are released together.
+  record *r;
+  {
+    mem::arenaScope scope;
+    mem::phaseScope phase(mem::TRANSLATE);
+    r=ast->transAsFile(*this, id);
+    if(settings::verbose > 3) {
+      size_t n=mem::arena::current()->size();
+      cerr << "Releasing " << n << " bytes used to translate " << filename
+           << " (" << mem::arena::released()+n << " in all)" << endl;
+    }
+  }
 
+  building.pop_front();
   inTranslation.remove(filename);
 
+  if(c->cacheable && !em.errors()) {
+    c->r=r;
+    moduleCache[filename]=c;
+  }
+
   return r;
 }
 
+record *genv::getCachedModule(string filename) {
+  if(!settings::cachemodules)
+    return 0;
+
+  moduleCache_t::iterator p=moduleCache.find(filename);
+  if(p == moduleCache.end())
+    return 0;
+
+  cachedModule *c=p->second;
+  if(c->key != translationKey())
+    return 0;
+
+  for(mem::list<source>::iterator s=c->sources.begin();
+      s != c->sources.end(); ++s) {
+    source now;
+    if(!stamp(s->name,now) || now.path != s->path || now.hash != s->hash)
+      return 0;
+  }
+
+  // The imported modules must be the very records that this module was
+  // translated against.  Getting them also adds them to this environment,
+  // where they are needed to initialize the module at runtime.
+  for(mem::list<cachedModule::import>::iterator i=c->imports.begin();
+      i != c->imports.end(); ++i)
+    if(getModule(i->id,i->filename) != i->r)
+      return 0;
+
+  return c->r;
+}
+
+void genv::addInclude(string filename) {
+  if(!building.empty())
+    building.front()->addSource(filename);
+}
+
 void genv::checkRecursion(string filename) {
   if (find(inTranslation.begin(), inTranslation.end(), filename) !=
       inTranslation.end()) {
@@ -100,18 +235,22 @@ record *genv::getModule(symbol id, string filename) {
   checkRecursion(filename);
 
   record *r=imap[filename];
-  if (r)
-    return r;
-  else {
-    record *r=loadModule(id, filename);
+  if (!r && (r=getCachedModule(filename)))
+    imap[filename]=r;
+  if (!r) {
+    r=loadModule(id, filename);
     // Don't add an erroneous module to the dictionary in interactive mode, as
     // the user may try to load it again.
     if (!interact::interactive || !em.errors())
       imap[filename]=r;
+  }
 
-    return r;
+  if (!building.empty()) {
+    cachedModule::import i={id,filename,r};
+    building.front()->imports.push_back(i);
   }
 
+  return r;
 }
 
 typedef vm::stack::importInitMap importInitMap;
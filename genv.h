@@ -29,6 +29,11 @@ using vm::lambda;
 
 namespace trans {
 
+// Translated modules are kept for the life of the process so that the global
+// environments of later files can reuse them.  A module is reused only if
+// the files it was translated from and the modules it imports are unchanged.
+struct cachedModule;
+
 class genv : public gc {
   // The initializer functions for imports, indexed by filename.
   typedef mem::map<CONST string,record *> importMap;
@@ -45,12 +50,22 @@ class genv : public gc {
   // Translate a module to build the record type.
   record *loadModule(symbol name, string s);
 
+  // The cache entries of the modules in translation, innermost first.
+  mem::list<cachedModule *> building;
+
+  // Returns the cached translation of a module if it is still current,
+  // otherwise null.
+  record *getCachedModule(string filename);
+
 public:
   genv();
 
   // Get an imported module, translating if necessary.
   record *getModule(symbol name, string s);
 
+  // Notes that a file was included into the module in translation.
+  void addInclude(string filename);
+
   // Uses the filename->record map to build a filename->initializer map to be
   // used at runtime.
   vm::stack::importInitMap *getInitMap();
@@ -0,0 +1,265 @@
+/*****
+ * hashmap.cc
+ *
+ * The map type used by the virtual machine: a hash table from keys of a
+ * primitive type to values.
+ *****/
+
+#include <cmath>
+#include <cstring>
+
+#include "hashmap.h"
+#include "pair.h"
+#include "triple.h"
+
+namespace vm {
+
+using camp::pair;
+using camp::triple;
+
+namespace {
+
+const Int EMPTY=-1;
+const Int DELETED=-2;
+
+const size_t minSlots=8;
+
+// The finalizer of splitmix64, which spreads the bits of x over the result.
+inline size_t mix(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return (size_t) x;
+}
+
+// Reals equal under == have the same hash; all NaNs are treated as one key.
+inline uint64_t realBits(double x)
+{
+  if(x == 0.0) return 0;
+  if(std::isnan(x)) return 0x7ff8000000000000ULL;
+  uint64_t u;
+  memcpy(&u,&x,sizeof(u));
+  return u;
+}
+
+inline bool realEqual(double a, double b)
+{
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+inline uint64_t combine(uint64_t h, double x)
+{
+  return mix(h ^ realBits(x))+0x9e3779b97f4a7c15ULL;
+}
+
+} // namespace
+
+hashmap::hashmap(keyKind kind, GCPlacement valuePlacement)
+  : kind(kind),
+    keys(arrayAllocator<item>(kind == INT || kind == REAL ? PointerFreeGC :
+                              UseGC)),
+    values(arrayAllocator<item>(valuePlacement)),
+    hashes(arrayAllocator<size_t>(PointerFreeGC)),
+    table(arrayAllocator<Int>(PointerFreeGC)),
+    deleted(0)
+{}
+
+size_t hashmap::hash(const item& key) const
+{
+  switch(kind) {
+    case INT:
+      return mix((uint64_t) get<Int>(key));
+    case REAL:
+      return mix(realBits(get<double>(key)));
+    case STRING: {
+      // FNV-1a.
+      const string *s=get<string*>(key);
+      uint64_t h=0xcbf29ce484222325ULL;
+      for(unsigned char c : *s) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+      }
+      return mix(h);
+    }
+    case PAIR: {
+      const pair *z=get<pair*>(key);
+      return mix(combine(combine(0,z->getx()),z->gety()));
+    }
+    case TRIPLE: {
+      const triple *v=get<triple*>(key);
+      return mix(combine(combine(combine(0,v->getx()),v->gety()),v->getz()));
+    }
+  }
+  return 0;
+}
+
+bool hashmap::equal(const item& a, const item& b) const
+{
+  switch(kind) {
+    case INT:
+      return get<Int>(a) == get<Int>(b);
+    case REAL:
+      return realEqual(get<double>(a),get<double>(b));
+    case STRING:
+      return *get<string*>(a) == *get<string*>(b);
+    case PAIR: {
+      const pair *z=get<pair*>(a), *w=get<pair*>(b);
+      return realEqual(z->getx(),w->getx()) && realEqual(z->gety(),w->gety());
+    }
+    case TRIPLE: {
+      const triple *u=get<triple*>(a), *v=get<triple*>(b);
+      return realEqual(u->getx(),v->getx()) &&
+        realEqual(u->gety(),v->gety()) && realEqual(u->getz(),v->getz());
+    }
+  }
+  return false;
+}
+
+size_t hashmap::probe(const item& key, size_t h, bool& found) const
+{
+  size_t mask=table.size()-1;
+  size_t free=table.size();
+  for(size_t i=h & mask;; i=(i+1) & mask) {
+    Int t=table[i];
+    if(t == EMPTY) {
+      found=false;
+      return free < table.size() ? free : i;
+    }
+    if(t == DELETED) {
+      if(free == table.size()) free=i;
+    } else if(hashes[t] == h && equal(keys[t],key)) {
+      found=true;
+      return i;
+    }
+  }
+}
+
+void hashmap::rehash(size_t slots)
+{
+  table.assign(slots,EMPTY);
+  deleted=0;
+  size_t mask=slots-1;
+  for(size_t t=0; t < keys.size(); ++t) {
+    size_t i=hashes[t] & mask;
+    while(table[i] != EMPTY)
+      i=(i+1) & mask;
+    table[i]=(Int) t;
+  }
+}
+
+item *hashmap::find(const item& key)
+{
+  size_t h=hash(key);
+  if(table.empty())
+    return 0;
+  bool found;
+  size_t i=probe(key,h,found);
+  return found ? &values[table[i]] : 0;
+}
+
+item& hashmap::operator[](const item& key)
+{
+  size_t h=hash(key);
+
+  // Keep at least a quarter of the slots empty, so that probes are short
+  // and always end.
+  size_t n=keys.size();
+  if(4*(n+deleted+1) > 3*table.size())
+    rehash(std::max(minSlots,4*(n+1) > 2*table.size() ? 2*table.size() :
+                    table.size()));
+
+  bool found;
+  size_t i=probe(key,h,found);
+  if(found)
+    return values[table[i]];
+
+  if(table[i] == DELETED) --deleted;
+  table[i]=(Int) n;
+  keys.push_back(key);
+  values.push_back(item());
+  hashes.push_back(h);
+  return values.back();
+}
+
+bool hashmap::erase(const item& key)
+{
+  size_t h=hash(key);
+  if(table.empty())
+    return false;
+  bool found;
+  size_t i=probe(key,h,found);
+  if(!found)
+    return false;
+
+  Int t=table[i];
+  table[i]=DELETED;
+  ++deleted;
+
+  // Move the last entry into the place of the erased one.
+  Int last=(Int) keys.size()-1;
+  if(t != last) {
+    size_t mask=table.size()-1;
+    size_t j=hashes[last] & mask;
+    while(table[j] != last)
+      j=(j+1) & mask;
+    table[j]=t;
+    keys[t]=keys[last];
+    values[t]=values[last];
+    hashes[t]=hashes[last];
+  }
+  keys.pop_back();
+  values.pop_back();
+  hashes.pop_back();
+  return true;
+}
+
+array *hashmap::keyArray() const
+{
+  array *a=new array(keys.size(),keys.get_allocator().getPlacement());
+  std::copy(keys.begin(),keys.end(),a->begin());
+  return a;
+}
+
+array *hashmap::valueArray() const
+{
+  array *a=new array(values.size(),values.get_allocator().getPlacement());
+  std::copy(values.begin(),values.end(),a->begin());
+  return a;
+}
+
+hashmap *hashmap::copy() const
+{
+  hashmap *m=new hashmap(kind,values.get_allocator().getPlacement());
+  m->keys=keys;
+  m->values=values;
+  m->hashes=hashes;
+  m->table=table;
+  m->deleted=deleted;
+  return m;
+}
+
+void hashmap::printKey(ostream& out, const item& key) const
+{
+  switch(kind) {
+    case INT:
+      out << get<Int>(key);
+      break;
+    case REAL:
+      out << get<double>(key);
+      break;
+    case STRING:
+      out << "\"" << *get<string*>(key) << "\"";
+      break;
+    case PAIR:
+      out << *get<pair*>(key);
+      break;
+    case TRIPLE:
+      out << *get<triple*>(key);
+      break;
+  }
+}
+
+} // namespace vm
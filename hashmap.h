@@ -0,0 +1,75 @@
+/*****
+ * hashmap.h
+ *
+ * The map type used by the virtual machine: a hash table from keys of a
+ * primitive type to values.
+ *****/
+
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include "array.h"
+
+namespace vm {
+
+class hashmap : public gc {
+public:
+  // The types of the keys, each with its own hashing and equality.
+  enum keyKind {INT, REAL, STRING, PAIR, TRIPLE};
+
+private:
+  typedef std::vector<size_t, arrayAllocator<size_t> > hashStorage;
+  typedef std::vector<Int, arrayAllocator<Int> > tableStorage;
+
+  keyKind kind;
+
+  // The entries, in the order inserted, except that deleting an entry moves
+  // the last entry into its place.
+  arrayStorage keys;
+  arrayStorage values;
+  hashStorage hashes;
+
+  // The open-addressed table of the indices of the entries, probed
+  // linearly.  Its size is zero or a power of two.
+  tableStorage table;
+  size_t deleted;
+
+  size_t hash(const item& key) const;
+  bool equal(const item& a, const item& b) const;
+
+  // Returns the slot of the table holding key, setting found, or else the
+  // slot at which to insert it.
+  size_t probe(const item& key, size_t h, bool& found) const;
+
+  // Rebuilds the table with the given number of slots.
+  void rehash(size_t slots);
+
+public:
+  hashmap(keyKind kind, GCPlacement valuePlacement);
+
+  size_t size() const {
+    return keys.size();
+  }
+
+  // Returns the value of key, or 0 if key is absent.
+  item *find(const item& key);
+
+  // Returns the value of key, inserting key with an uninitialized value if
+  // it is absent.
+  item& operator[](const item& key);
+
+  // Removes key, if present, returning whether it was.
+  bool erase(const item& key);
+
+  array *keyArray() const;
+  array *valueArray() const;
+
+  hashmap *copy() const;
+
+  // Writes key, for error messages.
+  void printKey(ostream& out, const item& key) const;
+};
+
+} // namespace vm
+
+#endif // HASHMAP_H
@@ -18,7 +18,7 @@
 namespace vm {
 
 // Forward declarations
-struct inst; class stack; class program;
+struct inst; class stack; class program; struct threadedCode;
 
 // A function "lambda," that is, the code that runs a function.
 // It also needs the closure of the enclosing module or function to run.
@@ -39,20 +39,28 @@ struct lambda : public gc {
   size_t framesize;
 
   // States whether any of the variables escape the function, in which case a
-  // closure needs to be allocated when the function is called.  It is
-  // initially set to "maybe" and it is computed the first time the function
-  // is called.
-  enum { NEEDS_CLOSURE, DOESNT_NEED_CLOSURE, MAYBE_NEEDS_CLOSURE} closureReq;
+  // closure needs to be allocated when the function is called.  A function
+  // whose closure is only used by nested functions while it runs has a
+  // scoped closure, taken from frames the stack reuses.  It is set by escape
+  // analysis when the function is translated; otherwise it is initially
+  // "maybe" and it is computed the first time the function is called.
+  enum { NEEDS_CLOSURE, DOESNT_NEED_CLOSURE, MAYBE_NEEDS_CLOSURE,
+         SCOPED_CLOSURE } closureReq;
 
-#ifdef DEBUG_FRAME
+  // The code pre-decoded for the threaded interpreter, built the first time
+  // the function is run that way.
+  threadedCode *threaded;
+
+  // The name of the function, as reported by the profilers.
   string name;
 
+#ifdef DEBUG_FRAME
   lambda()
-    : closureReq(MAYBE_NEEDS_CLOSURE), name("<unnamed>") {}
+    : closureReq(MAYBE_NEEDS_CLOSURE), threaded(0), name("<unnamed>") {}
   virtual ~lambda() {}
 #else
   lambda()
-    : closureReq(MAYBE_NEEDS_CLOSURE) {}
+    : closureReq(MAYBE_NEEDS_CLOSURE), threaded(0) {}
 #endif
 };
 
@@ -72,6 +80,23 @@ template<typename T>
 inline T get(const inst& it)
 { return get<T>(it.ref); }
 
+// Superinstructions with two integer operands (opcode type 'p') pack them
+// into the halves of a single Int.
+const int operandBits=4*sizeof(Int);
+
+inline bool packable(Int first, Int second)
+{
+  const Int limit=(Int) 1 << operandBits;
+  return first >= 0 && first < limit && second >= 0 && second < limit;
+}
+
+inline Int packOperands(Int first, Int second)
+{ return (Int) (((unsignedInt) second << operandBits) | first); }
+inline Int firstOperand(Int n)
+{ return (Int) ((unsignedInt) n & (((unsignedInt) 1 << operandBits)-1)); }
+inline Int secondOperand(Int n)
+{ return (Int) ((unsignedInt) n >> operandBits); }
+
 } // namespace vm
 
 #endif
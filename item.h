@@ -9,6 +9,7 @@
 #define ITEM_H
 
 #include "common.h"
+#include "gcstats.h"
 #include <cfloat>
 #include <cmath>
 
@@ -44,6 +45,26 @@ inline Int valueFromBool(bool b) {
 
 extern const item Default;
 
+#ifdef USEGC
+inline GCPlacement boxPlacement(GC_true_type) {return PointerFreeGC;}
+inline GCPlacement boxPlacement(GC_false_type) {return UseGC;}
+#endif
+
+// Box a copy of a value that does not fit in an item.  Small value types
+// such as pair, triple, and transform are declared with GC_DECLARE_PTRFREE;
+// their boxes are allocated as pointer-free memory, which the collector
+// never scans.
+template<class T>
+inline T *box(const T& v)
+{
+  mem::noteAllocation(mem::BOXES,sizeof(T));
+#ifdef USEGC
+  return new(boxPlacement(GC_type_traits<T>().GC_is_ptr_free)) T(v);
+#else
+  return new(UseGC) T(v);
+#endif
+}
+
 class item : public gc {
 private:
 
@@ -95,7 +116,7 @@ public:
 
   template<class T>
   item(const T &p)
-    : p(new(UseGC) T(p)) {
+    : p(box(p)) {
     assert(!empty());
   }
 
@@ -105,7 +126,7 @@ public:
 
   template<class T>
   item& operator= (const T &it)
-  { p=new(UseGC) T(it); return *this; }
+  { p=box(it); return *this; }
 #else
   bool empty() const
   {return *kind == typeid(void);}
@@ -139,7 +160,7 @@ public:
 
   template<class T>
   item(const T &p)
-    : kind(&typeid(T)), p(new(UseGC) T(p)) {}
+    : kind(&typeid(T)), p(box(p)) {}
 
   template<class T>
   item& operator= (T *a)
@@ -147,7 +168,7 @@ public:
 
   template<class T>
   item& operator= (const T &it)
-  { kind=&typeid(T); p=new(UseGC) T(it); return *this; }
+  { kind=&typeid(T); p=box(it); return *this; }
 
   const std::type_info &type() const
   { return *kind; }
@@ -53,6 +53,10 @@
 #endif
 
 #include "stack.h"
+#include "server.h"
+#include "sampler.h"
+#include "gcstats.h"
+#include "gcpolicy.h"
 
 using namespace settings;
 
@@ -142,6 +146,79 @@ int returnCode()
   return em.processStatus() || interact::interactive ? 0 : 1;
 }
 
+// Process the files named on the command line, or standard input if there
+// are none.
+void processFiles(Args *args)
+{
+  // The settings are reset for each file, so keep the profile name.
+  string profile=getSetting<string>("profile");
+  if(!profile.empty())
+    vm::startSampling(getSetting<Int>("profilerate"));
+  bool gcstats=getSetting<bool>("gcstats");
+  if(gcstats)
+    mem::countAllocations=true;
+  bool presize=getSetting<bool>("presize");
+
+  int n=numArgs();
+  if(n == 0) {
+    int inpipe=intcast(settings::getSetting<Int>("inpipe"));
+    if(inpipe >= 0) {
+      Signal(SIGHUP,hangup_handler);
+      camp::openpipeout();
+      fprintf(camp::pipeout,"\n");
+      fflush(camp::pipeout);
+    }
+    while(true) {
+      processFile("-",true);
+      try {
+        setOptions(args->argc,args->argv);
+      } catch(handled_error const&) {
+        em.statusError();
+      }
+      if(inpipe < 0) break;
+    }
+  } else {
+    for(int ind=0; ind < n; ind++) {
+      string name=(getArg(ind));
+      string prefix=stripExt(name);
+      if(name == prefix+".v3d") {
+        interact::uptodate=false;
+        runString("import v3d; defaultfilename=\""+stripDir(prefix)+
+                  "\"; importv3d(\""+name+"\");");
+      } else
+        processFile(name,n > 1);
+      try {
+        if(ind < n-1)
+          setOptions(args->argc,args->argv);
+      } catch(handled_error const&) {
+        em.statusError();
+      }
+    }
+  }
+
+  if(!profile.empty())
+    vm::stopSampling(profile);
+  if(gcstats)
+    mem::reportGCStats(cerr);
+  if(presize)
+    mem::recordPeakHeap(heapname());
+}
+
+// Run a job sent to the server.
+int serverJob(int argc, char *argv[])
+{
+  try {
+    setOptions(argc,argv);
+  } catch(handled_error const&) {
+    em.statusError();
+    return returnCode();
+  }
+
+  Args args(argc,argv);
+  processFiles(&args);
+  return returnCode();
+}
+
 void *asymain(void *A)
 {
   setsignal(signalHandler);
@@ -181,44 +258,15 @@ void *asymain(void *A)
     } catch(handled_error const&) {
       em.statusError();
     }
-  } else {
-    int n=numArgs();
-    if(n == 0) {
-      int inpipe=intcast(settings::getSetting<Int>("inpipe"));
-      if(inpipe >= 0) {
-        Signal(SIGHUP,hangup_handler);
-        camp::openpipeout();
-        fprintf(camp::pipeout,"\n");
-        fflush(camp::pipeout);
-      }
-      while(true) {
-        processFile("-",true);
-        try {
-          setOptions(args->argc,args->argv);
-        } catch(handled_error const&) {
-          em.statusError();
-        }
-        if(inpipe < 0) break;
-      }
-    } else {
-      for(int ind=0; ind < n; ind++) {
-        string name=(getArg(ind));
-        string prefix=stripExt(name);
-        if(name == prefix+".v3d") {
-          interact::uptodate=false;
-          runString("import v3d; defaultfilename=\""+stripDir(prefix)+
-                    "\"; importv3d(\""+name+"\");");
-        } else
-          processFile(name,n > 1);
-        try {
-          if(ind < n-1)
-            setOptions(args->argc,args->argv);
-        } catch(handled_error const&) {
-          em.statusError();
-        }
-      }
+  } else if(!getSetting<string>("server").empty()) {
+    preloadModules();
+    try {
+      server::serve(getSetting<string>("server"),serverJob);
+    } catch(handled_error const&) {
+      em.statusError();
     }
-  }
+  } else
+    processFiles(args);
 
 #ifdef PROFILE
   vm::dumpProfile();
@@ -74,6 +74,11 @@ types::ty *newRecordExp::transFromTyEntry(position pos, coenv &e,
   types::ty *t = ent->t;
   if (t->kind == ty_error)
     return t;
+  else if (t->kind == ty_map) {
+    // A new map is empty.
+    t->initializer()->encode(trans::CALL, pos, e.c);
+    return t;
+  }
   else if (t->kind != ty_record) {
     em.error(pos);
     em << "type '" << *t << "' is not a structure";
@@ -105,7 +110,7 @@ types::ty *newRecordExp::trans(coenv &e)
 types::ty *newRecordExp::getType(coenv &e)
 {
   types::ty *t = result->trans(e, true);
-  if (t->kind != ty_error && t->kind != ty_record)
+  if (t->kind != ty_error && t->kind != ty_record && t->kind != ty_map)
     return primError();
   else
     return t;
@@ -130,6 +135,8 @@ types::ty *newArrayExp::trans(coenv &e)
     return primError();
   }
 
+  bool packed = types::array::packedCell(c);
+
   if (dims)
     c = dims->truetype(c);
 
@@ -151,7 +158,8 @@ types::ty *newArrayExp::trans(coenv &e)
     e.c.encode(inst::intpush,
                (Int) ((dimexps ? dimexps->size():0)
                       + (dims ? dims->size():0)));
-    e.c.encode(inst::builtin, run::newDeepArray);
+    e.c.encode(inst::builtin, packed ? run::newDeepPackedArray :
+               run::newDeepArray);
 
     return c;
   } else {
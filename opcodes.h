@@ -14,6 +14,7 @@
  *   b - builtin
  *   l - lambda pointer
  *   o - instruction offset
+ *   p - two integers packed by packOperands
  */
 
 OPCODE(nop, 'x')
@@ -38,9 +39,22 @@ OPCODE(popframe,'x')
 OPCODE(push_default,'x')
 OPCODE(jump_if_not_default,'o')
 
-#ifdef COMBO
+/* Superinstructions introduced by the peephole optimizer. */
 OPCODE(varpop,'n')
 OPCODE(fieldpop,'n')
+OPCODE(varpush2,'p')
+OPCODE(varfieldpush,'p')
+OPCODE(fieldpush2,'p')
 
+/* A varpush whose successor is a builtin, which it runs directly. */
+OPCODE(varpush_builtin,'n')
+
+/* Comparisons of two integers fused with a conditional jump. */
+OPCODE(ltjmp,'o')
+OPCODE(lejmp,'o')
 OPCODE(gejmp,'o')
-#endif
+OPCODE(gtjmp,'o')
+
+/* A call whose value is returned at once, which runs in place of the caller
+ * rather than within it. */
+OPCODE(tailcall,'x')
@@ -7,8 +7,14 @@
 #include <fstream>
 #include <sstream>
 #include <cstring>
+#include <cctype>
 #include <fcntl.h>
+#include <unistd.h>
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <set>
+#include <vector>
 
 #include "common.h"
 
@@ -16,14 +22,21 @@
 #include <sys/stat.h>
 #endif
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 #ifdef HAVE_LIBCURL
 #include <curl/curl.h>
 #endif
 
 #include "interact.h"
 #include "locate.h"
+#include "settings.h"
 #include "errormsg.h"
+#include "gcstats.h"
 #include "parser.h"
+#include "sampler.h"
 #include "util.h"
 
 // The lexical analysis and parsing functions used by parseFile.
@@ -46,8 +59,56 @@ size_t stream_input(char *buf, size_t max_size)
   return sbuf ? sbuf->sgetn(buf,max_size) : 0;
 }
 
+const char *mbuf = NULL;
+size_t mlen = 0;
+
+size_t memory_input(char *buf, size_t max_size)
+{
+  size_t n=std::min(max_size,mlen);
+  memcpy(buf,mbuf,n);
+  mbuf += n;
+  mlen -= n;
+  return n;
+}
+
 } // namespace yy
 
+#ifdef HAVE_MMAP
+// A source file mapped into memory.  Only nonempty regular files are
+// mapped; others, such as pipes, are left to be read as streams.
+class mappedFile {
+  int fd;
+  void *addr;
+  size_t length;
+public:
+  mappedFile(const char *name) : fd(-1), addr(MAP_FAILED), length(0) {
+    struct stat buf;
+    if(stat(name,&buf) != 0 || !S_ISREG(buf.st_mode) || buf.st_size == 0)
+      return;
+
+    fd=::open(name,O_RDONLY);
+    if(fd < 0) return;
+
+    length=buf.st_size;
+    addr=mmap(NULL,length,PROT_READ,MAP_PRIVATE,fd,0);
+  }
+
+  ~mappedFile() {
+    if(addr != MAP_FAILED) munmap(addr,length);
+    if(fd >= 0) ::close(fd);
+  }
+
+  bool ok() {return addr != MAP_FAILED;}
+  const char *data() {return (const char *) addr;}
+  size_t size() {return length;}
+
+  // Asks the kernel to start reading in the whole file.
+  void willNeed() {
+    madvise(addr,length,MADV_WILLNEED);
+  }
+};
+#endif
+
 void debug(bool state)
 {
   // For debugging the machine-generated lexer and parser.
@@ -67,10 +128,13 @@ void error(const string& filename)
 absyntax::file *doParse(size_t (*input) (char* bif, size_t max_size),
                         const string& filename, bool extendable=false)
 {
+  mem::phaseScope phase(mem::PARSE);
   setlexer(input,filename);
   absyntax::file *root = yyparse() == 0 ? absyntax::root : 0;
   absyntax::root = 0;
   yy::sbuf = 0;
+  yy::mbuf = 0;
+  yy::mlen = 0;
 
   if (!root) {
     if (lexerEOF()) {
@@ -129,6 +193,15 @@ absyntax::file *parseFile(const string& filename,
 
   debug(false);
 
+#ifdef HAVE_MMAP
+  mappedFile source(file.c_str());
+  if(source.ok()) {
+    yy::mbuf = source.data();
+    yy::mlen = source.size();
+    return doParse(yy::memory_input,file);
+  }
+#endif
+
   std::filebuf filebuf;
   if(!filebuf.open(file.c_str(),std::ios::in))
     error(filename);
@@ -163,6 +236,192 @@ absyntax::file *parseString(const string& code,
   return doParse(yy::stream_input,filename,extendable);
 }
 
+namespace {
+
+// Finds the names of the modules and files that the code in [p,end) loads
+// through import, access, from ... access, and include statements, without
+// parsing it.  Statements within strings and comments are skipped.
+class importScanner {
+  const char *p, *end;
+
+  enum token {END, ID, STRING, OTHER};
+
+  token next(std::string& text) {
+    for(;;) {
+      while(p < end && isspace((unsigned char) *p)) ++p;
+      if(p == end) return END;
+      if(*p == '/' && p+1 < end && p[1] == '/') {
+        while(p < end && *p != '\n') ++p;
+      } else if(*p == '/' && p+1 < end && p[1] == '*') {
+        p += 2;
+        while(p+1 < end && !(*p == '*' && p[1] == '/')) ++p;
+        p=std::min(p+2,end);
+      } else break;
+    }
+
+    if(isalnum((unsigned char) *p) || *p == '_') {
+      const char *start=p;
+      while(p < end && (isalnum((unsigned char) *p) || *p == '_')) ++p;
+      text.assign(start,p);
+      return ID;
+    }
+
+    if(*p == '"' || *p == '\'') {
+      char quote=*p++;
+      text.clear();
+      while(p < end && *p != quote) {
+        if(*p == '\\' && p+1 < end) ++p;
+        text += *p++;
+      }
+      if(p < end) ++p;
+      return STRING;
+    }
+
+    text.assign(p,p+1);
+    ++p;
+    return OTHER;
+  }
+
+public:
+  importScanner(const char *p, size_t length) : p(p), end(p+length) {}
+
+  void scan(std::deque<std::string>& names) {
+    std::string text,name;
+    token t;
+    while((t=next(text)) != END) {
+      if(t != ID) continue;
+      if(text == "import" || text == "access") {
+        // A comma-separated list of names, each possibly followed by
+        // 'as' and an identifier.
+        do {
+          t=next(name);
+          if(t != ID && t != STRING) break;
+          names.push_back(name);
+          while((t=next(text)) != END && text != "," && text != ";") {}
+        } while(t != END && text == ",");
+      } else if(text == "from") {
+        if((t=next(name)) != ID && t != STRING) continue;
+        if(next(text) == ID && text == "access")
+          names.push_back(name);
+      } else if(text == "include") {
+        if((t=next(name)) == ID || t == STRING)
+          names.push_back(name);
+      }
+    }
+  }
+};
+
+#if defined(HAVE_MMAP) && defined(HAVE_PTHREAD)
+// Reads the files reachable from a file on a separate thread.  It keeps its
+// own copy of the search path, as the settings may be reset while it runs,
+// and uses no garbage-collected memory.
+struct prefetcher {
+  std::vector<std::string> dirs;
+  std::deque<std::string> names;
+  std::set<std::string> visited;
+  std::atomic<bool> stop;
+  pthread_t thread;
+
+  prefetcher(const string& filename) : stop(false) {
+    for(settings::file_list_t::iterator p=settings::searchPath.begin();
+        p != settings::searchPath.end(); ++p)
+      dirs.push_back(std::string(p->c_str()));
+    names.push_back(std::string(filename.c_str()));
+    if(settings::getSetting<bool>("autoplain"))
+      names.push_back("plain");
+  }
+
+  static bool exists(const std::string& file) {
+    return ::access(file.c_str(),R_OK) == 0;
+  }
+
+  // Follows settings::locateFile.
+  std::string locate(const std::string& id) {
+    std::string suffix=std::string(".")+settings::suffix.c_str();
+    std::string leaves[2];
+    size_t n=id.rfind(".");
+    if(n != std::string::npos && id.substr(n) == suffix) {
+      leaves[0]=id;
+      leaves[1]=id+suffix;
+    } else {
+      leaves[0]=id+suffix;
+      leaves[1]=id;
+    }
+    for(size_t i=0; i < 2; ++i) {
+      const std::string& leaf=leaves[i];
+      if(leaf[0] == '/') {
+        if(exists(leaf)) return leaf;
+      } else {
+        for(size_t j=0; j < dirs.size(); ++j) {
+          const std::string& dir=dirs[j];
+          std::string file=dir == "." ? leaf :
+            *dir.rbegin() == '/' ? dir+leaf : dir+"/"+leaf;
+          if(exists(file)) return file;
+        }
+      }
+    }
+    return std::string();
+  }
+
+  void run() {
+    while(!stop && !names.empty()) {
+      std::string name=names.front();
+      names.pop_front();
+      if(name.empty() || name.find("://") != std::string::npos ||
+         !visited.insert(name).second)
+        continue;
+
+      std::string file=locate(name);
+      if(file.empty()) continue;
+
+      // Scanning the file reads it into the page cache.
+      mappedFile source(file.c_str());
+      if(source.ok()) {
+        source.willNeed();
+        importScanner(source.data(),source.size()).scan(names);
+      }
+    }
+  }
+
+  static void *start(void *arg) {
+    vm::blockSampling();
+    ((prefetcher *) arg)->run();
+    return NULL;
+  }
+};
+
+prefetcher *prefetching=NULL;
+#endif
+
+} // namespace
+
+void prefetch(const string& filename)
+{
+#if defined(HAVE_MMAP) && defined(HAVE_PTHREAD)
+  endPrefetch();
+  if(filename.empty() || filename == "-" || isURL(filename))
+    return;
+
+  prefetcher *P=new prefetcher(filename);
+  if(pthread_create(&P->thread,NULL,prefetcher::start,P) == 0)
+    prefetching=P;
+  else
+    delete P;
+#endif
+}
+
+void endPrefetch()
+{
+#if defined(HAVE_MMAP) && defined(HAVE_PTHREAD)
+  if(prefetching) {
+    prefetching->stop=true;
+    pthread_join(prefetching->thread,NULL);
+    delete prefetching;
+    prefetching=NULL;
+  }
+#endif
+}
+
 #ifdef HAVE_LIBCURL
 size_t curlCallback(char *data, size_t size, size_t n, stringstream& buf)
 {
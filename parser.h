@@ -30,6 +30,14 @@ absyntax::file *parseString(const string& code,
                             const string& filename,
                             bool extendable=false);
 
+// Starts reading, in the background, the files that the given file imports,
+// accesses, or includes, directly or indirectly, so that they are in memory
+// by the time they are parsed.
+void prefetch(const string& filename);
+
+// Waits for the reading started by prefetch to stop.
+void endPrefetch();
+
 bool isURL(const string& filename);
 bool readURL(stringstream& buf, const string& filename);
 
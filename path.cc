@@ -9,12 +9,14 @@
  *****/
 
 #include "path.h"
+#include "arctable.h"
 #include "util.h"
 #include "angle.h"
 #include "camperror.h"
 #include "mathop.h"
 #include "predicates.h"
 #include "rounding.h"
+#include "threadpool.h"
 
 namespace camp {
 
@@ -453,15 +455,6 @@ path path::subpath(double a, double b) const
   return p;
 }
 
-// Special case of subpath for paths of length 1 used by intersect.
-void path::halve(path &first, path &second) const
-{
-  solvedKnot sn[3];
-  splitCubic(sn,0.5,nodes[0],nodes[1]);
-  first=path(sn[0],sn[1]);
-  second=path(sn[1],sn[2]);
-}
-
 // Calculate the coefficients of a Bezier derivative divided by 3.
 static inline void derivative(pair& a, pair& b, pair& c,
                               const pair& z0, const pair& c0,
@@ -509,6 +502,45 @@ bbox path::bounds() const
   return box;
 }
 
+bbox path::bounds(const transform& t) const
+{
+  if(empty()) return bbox();
+
+  // When each coordinate of t*z depends on only one coordinate of z, the
+  // corners of the bounds of the path map to corners of the bounds of t*p.
+  if((t.getxy() == 0 && t.getyx() == 0) ||
+     (t.getxx() == 0 && t.getyy() == 0)) {
+    bbox b=bounds();
+    bbox B(t*b.Min());
+    B += t*b.Max();
+    return B;
+  }
+
+  Int len=length();
+  bbox B(t*point(len));
+  for(Int i=0; i < len; ++i) {
+    pair z0=t*point(i);
+    B += z0;
+    if(straight(i)) continue;
+
+    pair a,b,c;
+    derivative(a,b,c,z0,t*postcontrol(i),t*precontrol(i+1),t*point(i+1));
+
+    quadraticroots x(a.getx(),b.getx(),c.getx());
+    if(x.distinct != quadraticroots::NONE && goodroot(x.t1))
+      B += t*point(i+x.t1);
+    if(x.distinct == quadraticroots::TWO && goodroot(x.t2))
+      B += t*point(i+x.t2);
+
+    quadraticroots y(a.gety(),b.gety(),c.gety());
+    if(y.distinct != quadraticroots::NONE && goodroot(y.t1))
+      B += t*point(i+y.t1);
+    if(y.distinct == quadraticroots::TWO && goodroot(y.t2))
+      B += t*point(i+y.t2);
+  }
+  return B;
+}
+
 bbox path::bounds(double min, double max) const
 {
   bbox box;
@@ -601,92 +633,20 @@ double arcLength(const pair& z0, const pair& c0, const pair& c1,
   return integral;
 }
 
-double path::cubiclength(Int i, double goal) const
+const arcTable& path::arcLengths() const
 {
-  const pair& z0=point(i);
-  const pair& z1=point(i+1);
-  double L;
-  if(straight(i)) {
-    L=(z1-z0).length();
-    return (goal < 0 || goal >= L) ? L : -goal/L;
-  }
-
-  double integral=arcLength(z0,postcontrol(i),precontrol(i+1),z1);
-
-  L=3.0*integral;
-  if(goal < 0 || goal >= L) return L;
-
-  double t=goal/L;
-  goal *= third;
-  static double dxmin=sqrt(DBL_EPSILON);
-  if(!unsimpson(goal,ds,0.0,t,100.0*DBL_EPSILON,integral,1.0,dxmin))
-    reportError("nesting capacity exceeded in computing arctime");
-  return -t;
+  if(!arcs) arcs=new arcTable(*this);
+  return *arcs;
 }
 
 double path::arclength() const
 {
-  if (cached_length != -1) return cached_length;
-
-  double L=0.0;
-  for (Int i = 0; i < n-1; i++) {
-    L += cubiclength(i);
-  }
-  if(cycles) L += cubiclength(n-1);
-  cached_length = L;
-  return cached_length;
+  return arcLengths().length();
 }
 
 double path::arctime(double goal) const
 {
-  if (cycles) {
-    if (goal == 0 || cached_length == 0) return 0;
-    if (goal < 0)  {
-      const path &rp = this->reverse();
-      double result = -rp.arctime(-goal);
-      return result;
-    }
-    if (cached_length > 0 && goal >= cached_length) {
-      Int loops = (Int)(goal / cached_length);
-      goal -= loops*cached_length;
-      return loops*n+arctime(goal);
-    }
-  } else {
-    if (goal <= 0)
-      return 0;
-    if (cached_length > 0 && goal >= cached_length)
-      return n-1;
-  }
-
-  double l,L=0;
-  for (Int i = 0; i < n-1; i++) {
-    l = cubiclength(i,goal);
-    if (l < 0)
-      return (-l+i);
-    else {
-      L += l;
-      goal -= l;
-      if (goal <= 0)
-        return i+1;
-    }
-  }
-  if (cycles) {
-    l = cubiclength(n-1,goal);
-    if (l < 0)
-      return -l+n-1;
-    if (cached_length > 0 && cached_length != L+l) {
-      reportError("arclength != length.\n"
-                  "path::arclength(double) must have broken semantics.\n"
-                  "Please report this error.");
-    }
-    cached_length = L += l;
-    goal -= l;
-    return arctime(goal)+n;
-  }
-  else {
-    cached_length = L;
-    return length();
-  }
+  return camp::arctime(*this,arcLengths(),goal);
 }
 
 // }}}
@@ -902,194 +862,578 @@ void add(std::vector<double>& S, double s, const path& p, double fuzz2)
   S.push_back(s);
 }
 
-void add(std::vector<double>& S, std::vector<double>& T, double s, double t,
-         const path& p, double fuzz2)
+void intersections(std::vector<double>& S, path& g,
+                   const pair& p, const pair& q, double fuzz)
 {
-  pair z=p.point(s);
-  size_t n=S.size();
+  double fuzz2=max(fuzzFactor*fuzz*fuzz,Fuzz2);
+  std::vector<double> S1;
+  lineintersections(S1,g,p,q,fuzz);
+  size_t n=S1.size();
   for(size_t i=0; i < n; ++i)
-    if((p.point(S[i])-z).abs2() <= fuzz2) return;
-  S.push_back(s);
-  T.push_back(t);
+    add(S,S1[i],g,fuzz2);
 }
 
-void add(double& s, double& t, std::vector<double>& S, std::vector<double>& T,
-         std::vector<double>& S1, std::vector<double>& T1,
-         double pscale, double qscale, double poffset, double qoffset,
-         const path& p, double fuzz2, bool single)
+namespace {
+
+// Path-path intersections.  The search follows the subdivision of The
+// MetaFontbook, so that intersect returns the first intersection in that
+// order, but keeps the parts of the paths it searches on the stack instead
+// of allocating subpaths: a part is either the whole segments [a,b) of a
+// path, whose bounds are computed once, or the times [t0,t1] of segment a,
+// held as the control points of a cubic.  A pair of segment parts is
+// skipped as soon as either lies outside the fat line of the other.
+
+const size_t maxcount=9;
+
+// The number of segments of a pair of parts above which the subdivisions of
+// the pair are searched in parallel.
+const Int parallelSegments=64;
+
+// An intersection at times s of p and t of q, and the point z of p there.
+struct hit {
+  double s,t;
+  pair z;
+};
+
+typedef std::vector<hit> hitlist;
+
+inline pair bezier(const pair z[], double t)
 {
-  if(single) {
-    s=s*pscale+poffset;
-    t=t*qscale+qoffset;
-  } else {
-    size_t n=S1.size();
-    for(size_t i=0; i < n; ++i)
-      add(S,T,pscale*S1[i]+poffset,qscale*T1[i]+qoffset,p,fuzz2);
-  }
+  double one_t=1.0-t;
+  pair ab=one_t*z[0]+t*z[1],
+    bc=one_t*z[1]+t*z[2],
+    cd=one_t*z[2]+t*z[3],
+    abc=one_t*ab+t*bc,
+    bcd=one_t*bc+t*cd;
+  return one_t*abc+t*bcd;
 }
 
-void add(double& s, double& t, std::vector<double>& S, std::vector<double>& T,
-         std::vector<double>& S1, std::vector<double>& T1,
-         const path& p, double fuzz2, bool single)
+inline void include(pair& min, pair& max, const pair& z)
 {
-  size_t n=S1.size();
-  if(single) {
-    if(n > 0) {
-      s=S1[0];
-      t=T1[0];
-    }
-  } else {
-    for(size_t i=0; i < n; ++i)
-      add(S,T,S1[i],T1[i],p,fuzz2);
-  }
+  min=pair(std::min(min.getx(),z.getx()),std::min(min.gety(),z.gety()));
+  max=pair(std::max(max.getx(),z.getx()),std::max(max.gety(),z.gety()));
 }
 
-void intersections(std::vector<double>& S, path& g,
-                   const pair& p, const pair& q, double fuzz)
+// The exact bounds of a cubic, as computed by path::bounds.
+void bounds(pair& min, pair& max, const pair z[], bool straight)
 {
-  double fuzz2=max(fuzzFactor*fuzz*fuzz,Fuzz2);
-  std::vector<double> S1;
-  lineintersections(S1,g,p,q,fuzz);
-  size_t n=S1.size();
-  for(size_t i=0; i < n; ++i)
-    add(S,S1[i],g,fuzz2);
+  min=max=z[0];
+  include(min,max,z[3]);
+  if(straight) return;
+
+  pair a,b,c;
+  derivative(a,b,c,z[0],z[1],z[2],z[3]);
+
+  quadraticroots x(a.getx(),b.getx(),c.getx());
+  if(x.distinct != quadraticroots::NONE && goodroot(x.t1))
+    include(min,max,bezier(z,x.t1));
+  if(x.distinct == quadraticroots::TWO && goodroot(x.t2))
+    include(min,max,bezier(z,x.t2));
+
+  quadraticroots y(a.gety(),b.gety(),c.gety());
+  if(y.distinct != quadraticroots::NONE && goodroot(y.t1))
+    include(min,max,bezier(z,y.t1));
+  if(y.distinct == quadraticroots::TWO && goodroot(y.t2))
+    include(min,max,bezier(z,y.t2));
 }
 
-bool intersections(double &s, double &t, std::vector<double>& S,
-                   std::vector<double>& T, path& p, path& q,
-                   double fuzz, bool single, bool exact, unsigned depth)
+inline void controls(pair z[], const path& p, Int i)
 {
-  if(errorstream::interrupt) throw interrupted();
+  z[0]=p.point(i);
+  z[1]=p.postcontrol(i);
+  z[2]=p.precontrol(i+1);
+  z[3]=p.point(i+1);
+}
 
-  double fuzz2=max(fuzzFactor*fuzz*fuzz,Fuzz2);
+// The bounds of the subpaths [a,b) visited by the subdivision, stored as a
+// tree whose root is node 0.
+class segmentBounds {
+  struct node {
+    pair min,max;
+    size_t left,right;
+  };
+
+  const path& p;
+  std::vector<node> nodes;
+
+  size_t build(Int a, Int b) {
+    size_t k=nodes.size();
+    nodes.push_back(node());
+    if(b-a <= 1) {
+      node& n=nodes[k];
+      if(b == a)
+        n.min=n.max=p.point(a);
+      else {
+        pair z[4];
+        controls(z,p,a);
+        bounds(n.min,n.max,z,p.straight(a));
+      }
+      n.left=n.right=0;
+    } else {
+      Int m=a+(b-a)/2;
+      size_t left=build(a,m);
+      size_t right=build(m,b);
+      node& n=nodes[k];
+      n.left=left;
+      n.right=right;
+      n.min=nodes[left].min;
+      n.max=nodes[left].max;
+      include(n.min,n.max,nodes[right].min);
+      include(n.min,n.max,nodes[right].max);
+    }
+    return k;
+  }
 
-  Int lp=p.length();
-  if(((lp == 1 && p.straight(0)) || lp == 0) && exact) {
-    std::vector<double> T1,S1;
-    intersections(T1,S1,q,p.point((Int) 0),p.point(lp),fuzz);
-    add(s,t,S,T,S1,T1,p,fuzz2,single);
-    return S1.size() > 0;
+public:
+  segmentBounds(const path& p) : p(p) {
+    nodes.reserve(2*p.length()+1);
+    build(0,p.length());
   }
 
-  Int lq=q.length();
-  if(((lq == 1 && q.straight(0)) || lq == 0) && exact) {
-    std::vector<double> S1,T1;
-    intersections(S1,T1,p,q.point((Int) 0),q.point(lq),fuzz);
-    add(s,t,S,T,S1,T1,p,fuzz2,single);
-    return S1.size() > 0;
+  const pair& min(size_t k) const {return nodes[k].min;}
+  const pair& max(size_t k) const {return nodes[k].max;}
+  size_t left(size_t k) const {return nodes[k].left;}
+  size_t right(size_t k) const {return nodes[k].right;}
+};
+
+struct part {
+  Int a,b;
+  size_t node;
+  double t0,t1;
+  pair z[4];
+  bool straight;
+  bool segment; // Whether this is a part of the single segment a.
+  bool wrap;    // Whether times at the end of the (cyclic) path wrap to 0.
+  pair min,max;
+
+  Int length() const {return segment ? 1 : b-a;}
+
+  double time(double t) const {
+    return segment ? a+t0+(t1-t0)*t : a+t;
   }
 
-  pair maxp=p.max();
-  pair minp=p.min();
-  pair maxq=q.max();
-  pair minq=q.min();
-
-  if(maxp.getx()+fuzz >= minq.getx() &&
-     maxp.gety()+fuzz >= minq.gety() &&
-     maxq.getx()+fuzz >= minp.getx() &&
-     maxq.gety()+fuzz >= minp.gety()) {
-    // Overlapping bounding boxes
-
-    --depth;
-//    fuzz *= 2;
-//    fuzz2=max(fuzzFactor*fuzz*fuzz,Fuzz2);
-
-    if((maxp-minp).length()+(maxq-minq).length() <= fuzz || depth == 0) {
-      if(single) {
-        s=0.5;
-        t=0.5;
-      } else {
-        S.push_back(0.5);
-        T.push_back(0.5);
-      }
-      return true;
+  double size() const {return (max-min).length();}
+};
+
+inline bool overlap(const part& p, const part& q, double fuzz)
+{
+  return p.max.getx()+fuzz >= q.min.getx() &&
+    p.max.gety()+fuzz >= q.min.gety() &&
+    q.max.getx()+fuzz >= p.min.getx() &&
+    q.max.gety()+fuzz >= p.min.gety();
+}
+
+// Appends to r the times of a cubic at which it passes within fuzz of z.
+void pointtimes(double r[], size_t& n, const pair c[], const pair& z,
+                double fuzz)
+{
+  double fuzz2=fuzz*fuzz;
+  double t[6];
+  size_t m=0;
+  cubicroots x(c[3].getx()-c[0].getx()+3.0*(c[1].getx()-c[2].getx()),
+               3.0*(c[0].getx()+c[2].getx())-6.0*c[1].getx(),
+               3.0*(c[1].getx()-c[0].getx()),c[0].getx()-z.getx());
+  if(x.roots >= 1) t[m++]=x.t1;
+  if(x.roots >= 2) t[m++]=x.t2;
+  if(x.roots == 3) t[m++]=x.t3;
+  cubicroots y(c[3].gety()-c[0].gety()+3.0*(c[1].gety()-c[2].gety()),
+               3.0*(c[0].gety()+c[2].gety())-6.0*c[1].gety(),
+               3.0*(c[1].gety()-c[0].gety()),c[0].gety()-z.gety());
+  if(y.roots >= 1) t[m++]=y.t1;
+  if(y.roots >= 2) t[m++]=y.t2;
+  if(y.roots == 3) t[m++]=y.t3;
+  for(size_t j=0; j < m; ++j) {
+    double s=t[j];
+    if(s >= -Fuzz2 && s <= 1.0+Fuzz2 &&
+       (bezier(c,std::min(std::max(s,0.0),1.0))-z).abs2() <= fuzz2)
+      r[n++]=s;
+  }
+}
+
+// Appends to r the times of a cubic at which it meets the segment from A to
+// B, and to u the corresponding times along the segment, as
+// intersections(S,T,g,A,B,fuzz) does for a path of one segment.
+void segmenttimes(double r[], double u[], size_t& n, const pair c[],
+                  const pair& A, const pair& B, double fuzz)
+{
+  double length2=(B-A).abs2();
+  double t[18];
+  size_t m=0;
+  if(length2 == 0.0) {
+    pointtimes(t,m,c,A,fuzz);
+    for(size_t j=0; j < m; ++j) {
+      r[n]=t[j];
+      u[n++]=0.0;
     }
+    return;
+  }
 
-    path p1,p2;
-    double pscale,poffset;
-    std::vector<double> S1,T1;
+  double dx=B.getx()-A.getx();
+  double dy=B.gety()-A.gety();
+  double det=A.gety()*B.getx()-A.getx()*B.gety();
+  pair t3=c[3]-c[0]+3.0*(c[1]-c[2]);
+  pair t2=3.0*(c[0]+c[2])-6.0*c[1];
+  pair t1=3.0*(c[1]-c[0]);
+  double a=dy*t3.getx()-dx*t3.gety();
+  double b=dy*t2.getx()-dx*t2.gety();
+  double cc=dy*t1.getx()-dx*t1.gety();
+  double d=dy*c[0].getx()-dx*c[0].gety()+det;
+  if(max(max(max(a*a,b*b),cc*cc),d*d) >
+     Fuzz4*max(max(max(c[0].abs2(),c[3].abs2()),c[1].abs2()),c[2].abs2())) {
+    cubicroots roots(a,b,cc,d);
+    if(roots.roots >= 1) t[m++]=roots.t1;
+    if(roots.roots >= 2) t[m++]=roots.t2;
+    if(roots.roots == 3) t[m++]=roots.t3;
+  } else t[m++]=0.0;
+  pointtimes(t,m,c,A,fuzz);
+  pointtimes(t,m,c,B,fuzz);
+  if(online(A,B,c[0],fuzz)) t[m++]=0.0;
+  if(online(A,B,c[3],fuzz)) t[m++]=1.0;
+
+  pair factor=(B-A)/length2;
+  for(size_t j=0; j < m; ++j) {
+    double s=t[j];
+    if(s >= -Fuzz2 && s <= 1.0+Fuzz2) {
+      double v=dot(bezier(c,std::min(std::max(s,0.0),1.0))-A,factor);
+      if(v >= -Fuzz2 && v <= 1.0+Fuzz2) {
+        r[n]=s;
+        u[n++]=v;
+      }
+    }
+  }
+}
 
-    if(lp <= 1) {
-      if(lp == 1) p.halve(p1,p2);
-      if(lp == 0 || p1 == p || p2 == p) {
-        intersections(T1,S1,q,p.point((Int) 0),p.point((Int) 0),fuzz);
-        add(s,t,S,T,S1,T1,p,fuzz2,single);
-        return S1.size() > 0;
+// Returns false if the segment part p can't come within fuzz of the segment
+// part q, using the fat line of q.  The fat line is widened so that nothing
+// that the subdivision would report is skipped.
+bool fatline(const part& p, const part& q, double fuzz)
+{
+  pair d=q.z[3]-q.z[0];
+  if(d == 0.0) d=q.z[2]-q.z[0];
+  if(d == 0.0) d=q.z[1]-q.z[0];
+  if(d == 0.0) return true;
+
+  pair n=unit(pair(-d.gety(),d.getx()));
+  double c=-dot(n,q.z[0]);
+  double d1=dot(n,q.z[1])+c;
+  double d2=dot(n,q.z[2])+c;
+  double factor=d1*d2 > 0.0 ? 0.75 : 4.0/9.0;
+  double w=3.0*fuzz+Fuzz2*(fabs(c)+q.size());
+  double dmin=factor*std::min(0.0,std::min(d1,d2))-w;
+  double dmax=factor*std::max(0.0,std::max(d1,d2))+w;
+
+  // Intersect the convex hull of the points (i/3,D[i]) with the fat line.
+  double D[4];
+  for(int i=0; i < 4; ++i)
+    D[i]=dot(n,p.z[i])+c;
+  double tmin=2.0, tmax=-1.0;
+  for(int i=0; i < 4; ++i) {
+    if(D[i] >= dmin && D[i] <= dmax) {
+      tmin=std::min(tmin,i*third);
+      tmax=std::max(tmax,i*third);
+    }
+    for(int j=i+1; j < 4; ++j) {
+      double bound[]={dmin,dmax};
+      for(int k=0; k < 2; ++k) {
+        double L=bound[k];
+        if((D[i]-L)*(D[j]-L) < 0.0) {
+          double t=(i+(j-i)*(L-D[i])/(D[j]-D[i]))*third;
+          tmin=std::min(tmin,t);
+          tmax=std::max(tmax,t);
+        }
       }
-      pscale=poffset=0.5;
-    } else {
-      Int tp=lp/2;
-      p1=p.subpath(0,tp);
-      p2=p.subpath(tp,lp);
-      poffset=tp;
-      pscale=1.0;
     }
+  }
+  return tmin <= tmax;
+}
 
-    path q1,q2;
-    double qscale,qoffset;
+class intersector {
+  const path& P;
+  const path& Q;
+  const segmentBounds& pbounds;
+  const segmentBounds& qbounds;
+  double fuzz;
+  double fuzz2;
+  bool single;
+  bool exact;
+
+  part root(const path& p, const segmentBounds& b) const {
+    part r;
+    r.a=0;
+    r.b=p.length();
+    r.node=0;
+    r.segment=false;
+    r.straight=false;
+    r.wrap=p.cyclic();
+    r.min=b.min(0);
+    r.max=b.max(0);
+    return r.b == 1 ? segmentOf(r,p) : r;
+  }
 
-    if(lq <= 1) {
-      if(lq == 1) q.halve(q1,q2);
-      if(lq == 0 || q1 == q || q2 == q) {
-        intersections(S1,T1,p,q.point((Int) 0),q.point((Int) 0),fuzz);
-        add(s,t,S,T,S1,T1,p,fuzz2,single);
-        return S1.size() > 0;
-      }
-      qscale=qoffset=0.5;
+  // Makes a subpath of one segment a part of that segment.
+  part segmentOf(const part& r, const path& p) const {
+    part s=r;
+    s.segment=true;
+    s.t0=0.0;
+    s.t1=1.0;
+    controls(s.z,p,r.a);
+    s.straight=p.straight(r.a);
+    return s;
+  }
+
+  // Splits a subpath in the middle, as the subdivision does.
+  void divide(const part& r, part& r1, part& r2, const path& p,
+              const segmentBounds& b) const {
+    Int m=r.a+(r.b-r.a)/2;
+    r1=r2=r;
+    r1.wrap=r2.wrap=false;
+    r1.b=r2.a=m;
+    r1.node=b.left(r.node);
+    r2.node=b.right(r.node);
+    r1.min=b.min(r1.node);
+    r1.max=b.max(r1.node);
+    r2.min=b.min(r2.node);
+    r2.max=b.max(r2.node);
+    if(r1.length() == 1) r1=segmentOf(r1,p);
+    if(r2.length() == 1) r2=segmentOf(r2,p);
+  }
+
+  // Halves a segment part as splitCubic does; returns false if either half
+  // is no different from the part.
+  bool halve(const part& s, part& s1, part& s2) const {
+    s1=s2=s;
+    s1.wrap=s2.wrap=false;
+    const pair *z=s.z;
+    if(s.straight) {
+      pair mid=split(0.5,z[0],z[3]);
+      pair deltaL=third*(mid-z[0]);
+      pair deltaR=third*(z[3]-mid);
+      s1.z[1]=z[0]+deltaL;
+      s1.z[2]=mid-deltaL;
+      s1.z[3]=s2.z[0]=mid;
+      s2.z[1]=mid+deltaR;
+      s2.z[2]=z[3]-deltaR;
     } else {
-      Int tq=lq/2;
-      q1=q.subpath(0,tq);
-      q2=q.subpath(tq,lq);
-      qoffset=tq;
-      qscale=1.0;
+      pair x=split(0.5,z[1],z[2]);
+      s1.z[1]=split(0.5,z[0],z[1]);
+      s2.z[2]=split(0.5,z[2],z[3]);
+      s1.z[2]=split(0.5,s1.z[1],x);
+      s2.z[1]=split(0.5,x,s2.z[2]);
+      s1.z[3]=s2.z[0]=split(0.5,s1.z[2],s2.z[1]);
     }
+    bool same1=true, same2=true;
+    for(int i=0; i < 4; ++i) {
+      if(s1.z[i] != z[i]) same1=false;
+      if(s2.z[i] != z[i]) same2=false;
+    }
+    if(same1 || same2) return false;
+    double tm=0.5*(s.t0+s.t1);
+    s1.t1=s2.t0=tm;
+    bounds(s1.min,s1.max,s1.z,s1.straight);
+    bounds(s2.min,s2.max,s2.z,s2.straight);
+    return true;
+  }
 
-    bool Short=lp == 1 && lq == 1;
+  // Finds the intersections of the part g with the straight part or point
+  // l, or with the start of l if point is set, as
+  // intersections(S,T,g,A,B,fuzz) does for a subpath g.  The times are
+  // those of p and q, or of q and p if swap is set.  Returns the number of
+  // intersections added.
+  size_t meet(const part& l, const part& g, const path& gp, bool swap,
+              hitlist& hits, bool point=false) const {
+    size_t start=hits.size();
+    pair A,B;
+    if(l.segment) {
+      A=l.z[0];
+      B=point ? A : l.z[3];
+    } else
+      A=B=(swap ? Q : P).point(l.a);
+
+    double r[18],u[18];
+    Int n=gp.length();
+    if(g.length() > 0) {
+      Int last=g.segment ? g.a+1 : g.b;
+      for(Int i=g.a; i < last; ++i) {
+        pair z[4];
+        if(g.segment)
+          for(int k=0; k < 4; ++k) z[k]=g.z[k];
+        else
+          controls(z,gp,i);
+        size_t m=0;
+        segmenttimes(r,u,m,z,A,B,fuzz);
+        for(size_t j=0; j < m; ++j) {
+          double s=g.segment ? g.time(r[j]) : i+r[j];
+          if(g.wrap && s >= n-Fuzz2) s=0;
+          double t=l.time(u[j]);
+          if(swap) record(hits,start,s,t);
+          else record(hits,start,t,s);
+          if(single) return 1;
+        }
+      }
+    } else if(A != B && online(A,B,gp.point(g.a),fuzz)) {
+      double v=dot(gp.point(g.a)-A,(B-A)/(B-A).abs2());
+      if(v >= -Fuzz2 && v <= 1.0+Fuzz2) {
+        double s=g.a;
+        double t=l.time(v);
+        if(swap) record(hits,start,s,t);
+        else record(hits,start,t,s);
+      }
+    }
+    return hits.size()-start;
+  }
 
-    static size_t maxcount=9;
-    size_t count=0;
+  // Adds the intersection at times s and t to hits, unless all of the
+  // intersections are wanted and it is within fuzz2 of one of hits[start,end).
+  void record(hitlist& hits, size_t start, double s, double t) const {
+    hit h={s,t,P.point(s)};
+    if(!single)
+      for(size_t i=start; i < hits.size(); ++i)
+        if((hits[i].z-h.z).abs2() <= fuzz2) return;
+    hits.push_back(h);
+  }
 
-    if(intersections(s,t,S1,T1,p1,q1,fuzz,single,exact,depth)) {
-      add(s,t,S,T,S1,T1,pscale,qscale,0.0,0.0,p,fuzz2,single);
-      if(single || depth <= mindepth)
-        return true;
-      count += S1.size();
-      if(Short && count > maxcount) return true;
-    }
+  size_t report(const part& p, const part& q, hitlist& hits) const {
+    hit h={p.time(0.5),q.time(0.5),P.point(p.time(0.5))};
+    hits.push_back(h);
+    return 1;
+  }
 
-    S1.clear();
-    T1.clear();
-    if(intersections(s,t,S1,T1,p1,q2,fuzz,single,exact,depth)) {
-      add(s,t,S,T,S1,T1,pscale,qscale,0.0,qoffset,p,fuzz2,single);
-      if(single || depth <= mindepth)
-        return true;
-      count += S1.size();
-      if(Short && count > maxcount) return true;
+  // Removes each of the intersections hits[mark,end) found by a subdivision
+  // that is within fuzz2 of one kept in hits[start,end) before it.  As in
+  // the recursive subdivision, intersections are only merged with those of
+  // the same subpaths, so that close but distinct crossings found in
+  // different subpaths are kept apart.
+  void merge(hitlist& hits, size_t start, size_t mark) const {
+    size_t end=mark;
+    for(size_t i=mark; i < hits.size(); ++i) {
+      bool seen=false;
+      for(size_t j=start; j < end && !seen; ++j)
+        seen=(hits[j].z-hits[i].z).abs2() <= fuzz2;
+      if(!seen) hits[end++]=hits[i];
     }
+    hits.resize(end);
+  }
+
+  // Searches the pairs of parts in order, as the subdivision does.
+  size_t searchAll(const part *p[], const part *q[], size_t pairs,
+                   unsigned depth, bool Short, hitlist& hits);
+
+public:
+  intersector(const path& P, const path& Q, const segmentBounds& pbounds,
+              const segmentBounds& qbounds, double fuzz, double fuzz2,
+              bool single, bool exact)
+    : P(P), Q(Q), pbounds(pbounds), qbounds(qbounds), fuzz(fuzz),
+      fuzz2(fuzz2), single(single), exact(exact) {}
+
+  // Appends the intersections of p and q to hits, returning their number.
+  size_t search(const part& p, const part& q, unsigned depth, hitlist& hits);
+
+  size_t search(hitlist& hits, unsigned depth) {
+    return search(root(P,pbounds),root(Q,qbounds),depth,hits);
+  }
+};
 
-    S1.clear();
-    T1.clear();
-    if(intersections(s,t,S1,T1,p2,q1,fuzz,single,exact,depth)) {
-      add(s,t,S,T,S1,T1,pscale,qscale,poffset,0.0,p,fuzz2,single);
-      if(single || depth <= mindepth)
-        return true;
-      count += S1.size();
-      if(Short && count > maxcount) return true;
+size_t intersector::searchAll(const part *p[], const part *q[], size_t pairs,
+                              unsigned depth, bool Short, hitlist& hits)
+{
+  size_t start=hits.size();
+
+  if(!single && depth > mindepth && !Short &&
+     p[0]->length()+q[0]->length() >= parallelSegments) {
+    std::vector<hitlist> found(pairs);
+    parallelFor(pairs,[&](size_t i) {
+        search(*p[i],*q[i],depth,found[i]);
+      });
+    for(size_t i=0; i < pairs; ++i) {
+      size_t mark=hits.size();
+      hits.insert(hits.end(),found[i].begin(),found[i].end());
+      merge(hits,start,mark);
     }
+    return hits.size()-start;
+  }
 
-    S1.clear();
-    T1.clear();
-    if(intersections(s,t,S1,T1,p2,q2,fuzz,single,exact,depth)) {
-      add(s,t,S,T,S1,T1,pscale,qscale,poffset,qoffset,p,fuzz2,single);
-      if(single || depth <= mindepth)
-        return true;
-      count += S1.size();
-      if(Short && count > maxcount) return true;
+  size_t count=0;
+  for(size_t i=0; i < pairs; ++i) {
+    size_t mark=hits.size();
+    size_t n=search(*p[i],*q[i],depth,hits);
+    if(n > 0) {
+      if(!single) merge(hits,start,mark);
+      if(single || depth <= mindepth) break;
+      count += n;
+      if(Short && count > maxcount) break;
     }
+  }
+  return hits.size()-start;
+}
 
-    return S.size() > 0;
+size_t intersector::search(const part& p, const part& q, unsigned depth,
+                           hitlist& hits)
+{
+  if(errorstream::interrupt) throw interrupted();
+
+  Int lp=p.length();
+  if(((lp == 1 && p.straight) || lp == 0) && exact)
+    return meet(p,q,Q,false,hits);
+
+  Int lq=q.length();
+  if(((lq == 1 && q.straight) || lq == 0) && exact)
+    return meet(q,p,P,true,hits);
+
+  if(!overlap(p,q,fuzz))
+    return 0;
+
+  --depth;
+  if(p.size()+q.size() <= fuzz || depth == 0) {
+    return report(p,q,hits);
   }
-  return false;
+
+  if(p.segment && q.segment && (!fatline(p,q,fuzz) || !fatline(q,p,fuzz)))
+    return 0;
+
+  part p1,p2;
+  if(lp == 0 || (lp == 1 && !halve(p,p1,p2)))
+    return meet(p,q,Q,false,hits,true);
+  if(lp > 1) divide(p,p1,p2,P,pbounds);
+
+  part q1,q2;
+  if(lq == 0 || (lq == 1 && !halve(q,q1,q2)))
+    return meet(q,p,P,true,hits,true);
+  if(lq > 1) divide(q,q1,q2,Q,qbounds);
+
+  const part *ps[]={&p1,&p1,&p2,&p2};
+  const part *qs[]={&q1,&q2,&q1,&q2};
+  return searchAll(ps,qs,4,depth,lp == 1 && lq == 1,hits);
+}
+
+} // namespace
+
+bool intersections(double &s, double &t, std::vector<double>& S,
+                   std::vector<double>& T, path& p, path& q,
+                   double fuzz, bool single, bool exact, unsigned depth)
+{
+  if(errorstream::interrupt) throw interrupted();
+
+  double fuzz2=max(fuzzFactor*fuzz*fuzz,Fuzz2);
+
+  checkEmpty(p.size());
+  checkEmpty(q.size());
+
+  segmentBounds pbounds(p), qbounds(q);
+  hitlist hits;
+  intersector(p,q,pbounds,qbounds,fuzz,fuzz2,single,exact).search(hits,depth);
+  if(hits.empty())
+    return false;
+
+  if(single) {
+    s=hits[0].s;
+    t=hits[0].t;
+  } else {
+    for(size_t i=0; i < hits.size(); ++i) {
+      S.push_back(hits[i].s);
+      T.push_back(hits[i].t);
+    }
+  }
+  return true;
 }
 
 // }}}
@@ -1250,13 +1594,13 @@ bool checkcurve(const pair& z0, const pair& c0, const pair& c1,
   return false;
 }
 
+const Int undefinedwinding=Int_MAX % 2 ? Int_MAX : Int_MAX-1;
+
 // Return the winding number of the region bounded by the (cyclic) path
-// relative to the point z, or the largest odd integer if the point lies on
-// the path.
+// relative to the point z, or undefinedwinding if the point lies on the
+// path.
 Int path::windingnumber(const pair& z) const
 {
-  static const Int undefined=Int_MAX % 2 ? Int_MAX : Int_MAX-1;
-
   if(!cycles)
     reportError("path is not cyclic");
 
@@ -1269,10 +1613,10 @@ Int path::windingnumber(const pair& z) const
   for(Int i=0; i < n; ++i)
     if(straight(i)) {
       if(checkstraight(point(i),point(i+1),z,count))
-        return undefined;
+        return undefinedwinding;
     } else
       if(checkcurve(point(i),postcontrol(i),precontrol(i+1),point(i+1),z,count,
-                    maxdepth)) return undefined;
+                    maxdepth)) return undefinedwinding;
   return count;
 }
 
@@ -17,6 +17,7 @@
 #include "pair.h"
 #include "transform.h"
 #include "bbox.h"
+#include "gcstats.h"
 
 inline double Intcap(double t) {
   if(t <= (double) Int_MIN) return (double) Int_MIN;
@@ -39,6 +40,8 @@ bool unsimpson(double integral, double (*)(double), double a, double& b,
 
 namespace camp {
 
+class arcTable;
+
 void checkEmpty(Int n);
 
 inline Int adjustedIndex(Int i, Int n, bool cycles)
@@ -81,19 +84,24 @@ class path : public gc {
   Int n; // The number of knots
 
   mem::vector<solvedKnot> nodes;
-  mutable double cached_length; // Cache length since path is immutable.
+  mutable arcTable *arcs; // Built when first needed; path is immutable.
 
   mutable bbox box;
   mutable bbox times; // Times where minimum and maximum extents are attained.
 
+  void noteKnots() const {
+    mem::noteAllocation(mem::PATHS,nodes.size()*sizeof(solvedKnot));
+  }
+
 public:
   path()
-    : cycles(false), n(0), nodes(), cached_length(-1) {}
+    : cycles(false), n(0), nodes(), arcs(0) {}
 
   // Create a path of a single point
   path(pair z, bool = false)
-    : cycles(false), n(1), nodes(1), cached_length(-1)
+    : cycles(false), n(1), nodes(1), arcs(0)
   {
+    noteKnots();
     nodes[0].pre = nodes[0].point = nodes[0].post = z;
     nodes[0].straight = false;
   }
@@ -102,8 +110,9 @@ public:
   // methods such as the guide solver, but should probably not be used by a
   // user of the system unless he knows what he is doing.
   path(mem::vector<solvedKnot>& nodes, Int n, bool cycles = false)
-    : cycles(cycles), n(n), nodes(nodes), cached_length(-1)
+    : cycles(cycles), n(n), nodes(nodes), arcs(0)
   {
+    noteKnots();
   }
 
   friend bool operator== (const path& p, const path& q)
@@ -113,8 +122,9 @@ public:
 
 public:
   path(solvedKnot n1, solvedKnot n2)
-    : cycles(false), n(2), nodes(2), cached_length(-1)
+    : cycles(false), n(2), nodes(2), arcs(0)
   {
+    noteKnots();
     nodes[0] = n1;
     nodes[1] = n2;
     nodes[0].pre = nodes[0].point;
@@ -123,9 +133,11 @@ public:
 
   // Copy constructor
   path(const path& p)
-    : cycles(p.cycles), n(p.n), nodes(p.nodes), cached_length(p.cached_length),
+    : cycles(p.cycles), n(p.n), nodes(p.nodes), arcs(p.arcs),
       box(p.box), times(p.times)
-  {}
+  {
+    noteKnots();
+  }
 
   path unstraighten() const
   {
@@ -313,12 +325,12 @@ public:
   path subpath(Int start, Int end) const;
   path subpath(double start, double end) const;
 
-  // Special case of subpath used by intersect.
-  void halve(path &first, path &second) const;
-
   // Used by picture to determine bounding box.
   bbox bounds() const;
 
+  // The bounding box of t*p, found without constructing t*p.
+  bbox bounds(const transform& t) const;
+
   pair mintimes() const {
     checkEmpty(n);
     bounds();
@@ -351,7 +363,9 @@ public:
   // Return bounding box accounting for internal pen padding (but not pencap).
   bbox internalbounds(const bbox &padding) const;
 
-  double cubiclength(Int i, double goal=-1) const;
+  // The table of arc lengths along the path.
+  const arcTable& arcLengths() const;
+
   double arclength () const;
   double arctime (double l) const;
   double directiontime(const pair& z) const;
@@ -366,6 +380,16 @@ public:
     return bounds().Min();
   }
 
+  pair max(const transform& t) const {
+    checkEmpty(n);
+    return bounds(t).Max();
+  }
+
+  pair min(const transform& t) const {
+    checkEmpty(n);
+    return bounds(t).Min();
+  }
+
   // Debugging output
   friend std::ostream& operator<< (std::ostream& out, const path& p);
 
@@ -393,6 +417,9 @@ extern const unsigned maxdepth;
 extern const unsigned mindepth;
 extern const char *nopoints;
 
+// The winding number of a point on a path: the largest odd integer.
+extern const Int undefinedwinding;
+
 bool intersect(double& S, double& T, path& p, path& q, double fuzz,
                unsigned depth=maxdepth);
 bool intersections(double& s, double& t, std::vector<double>& S,
@@ -442,6 +469,13 @@ path nurb(pair z0, pair z1, pair z2, pair z3,
 
 double orient2d(const pair& a, const pair& b, const pair& c);
 
+// Return true if z lies on z0--z1 or on the Bezier segment
+// z0..controls c0 and c1..z1; otherwise add the contribution of the segment
+// to the winding number count relative to z.
+bool checkstraight(const pair& z0, const pair& z1, const pair& z, Int& count);
+bool checkcurve(const pair& z0, const pair& c0, const pair& c1,
+                const pair& z1, const pair& z, Int& count, unsigned depth);
+
 void roots(std::vector<double> &roots, double a, double b, double c, double d);
 void roots(std::vector<double> &r, double x0, double c0, double c1, double x1,
            double x);
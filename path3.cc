@@ -8,6 +8,7 @@
 #include <cfloat>
 
 #include "path3.h"
+#include "arctable.h"
 #include "util.h"
 #include "camperror.h"
 #include "mathop.h"
@@ -322,6 +323,64 @@ bbox3 path3::bounds() const
   return box;
 }
 
+// Whether each coordinate of t*v depends on at most one coordinate of v.
+static bool axial(const double* t)
+{
+  for(size_t i=0; i < 12; i += 4)
+    if((t[i] != 0)+(t[i+1] != 0)+(t[i+2] != 0) > 1)
+      return false;
+  return true;
+}
+
+bbox3 path3::bounds(const double* t) const
+{
+  if(t == NULL) return bounds();
+  if(empty()) return bbox3();
+
+  // The control points of a projected path do not lie on the projection of
+  // the path, so bound the path they define.
+  if(t[12] != 0 || t[13] != 0 || t[14] != 0)
+    return transformed(t,*this).bounds();
+
+  // The corners of the bounds then map to corners of the bounds of t*p.
+  if(axial(t)) {
+    bbox3 b=bounds();
+    bbox3 B(t*b.Min());
+    B.add(t*b.Max());
+    return B;
+  }
+
+  Int len=length();
+  bbox3 B(t*point(len));
+  for(Int i=0; i < len; ++i) {
+    triple z0=t*point(i);
+    B.add(z0);
+    if(straight(i)) continue;
+
+    triple a,b,c;
+    derivative(a,b,c,z0,t*postcontrol(i),t*precontrol(i+1),t*point(i+1));
+
+    quadraticroots x(a.getx(),b.getx(),c.getx());
+    if(x.distinct != quadraticroots::NONE && goodroot(x.t1))
+      B.add(t*point(i+x.t1));
+    if(x.distinct == quadraticroots::TWO && goodroot(x.t2))
+      B.add(t*point(i+x.t2));
+
+    quadraticroots y(a.gety(),b.gety(),c.gety());
+    if(y.distinct != quadraticroots::NONE && goodroot(y.t1))
+      B.add(t*point(i+y.t1));
+    if(y.distinct == quadraticroots::TWO && goodroot(y.t2))
+      B.add(t*point(i+y.t2));
+
+    quadraticroots z(a.getz(),b.getz(),c.getz());
+    if(z.distinct != quadraticroots::NONE && goodroot(z.t1))
+      B.add(t*point(i+z.t1));
+    if(z.distinct == quadraticroots::TWO && goodroot(z.t2))
+      B.add(t*point(i+z.t2));
+  }
+  return B;
+}
+
 // Return f evaluated at controlling vertex of bounding box of convex hull for
 // similiar-triangle transform x'=x/z, y'=y/z, where z < 0.
 double ratiobound(triple z0, triple c0, triple c1, triple z1,
@@ -408,92 +467,20 @@ double arcLength(const triple& z0, const triple& c0, const triple& c1,
   return integral;
 }
 
-double path3::cubiclength(Int i, double goal) const
+const arcTable& path3::arcLengths() const
 {
-  const triple& z0=point(i);
-  const triple& z1=point(i+1);
-  double L;
-  if(straight(i)) {
-    L=(z1-z0).length();
-    return (goal < 0 || goal >= L) ? L : -goal/L;
-  }
-
-  double integral=arcLength(z0,postcontrol(i),precontrol(i+1),z1);
-
-  L=3.0*integral;
-  if(goal < 0 || goal >= L) return L;
-
-  double t=goal/L;
-  goal *= third;
-  static double dxmin=sqrt(DBL_EPSILON);
-  if(!unsimpson(goal,ds,0.0,t,100.0*DBL_EPSILON,integral,1.0,dxmin))
-    reportError("nesting capacity exceeded in computing arctime");
-  return -t;
+  if(!arcs) arcs=new arcTable(*this);
+  return *arcs;
 }
 
 double path3::arclength() const
 {
-  if (cached_length != -1) return cached_length;
-
-  double L=0.0;
-  for (Int i = 0; i < n-1; i++) {
-    L += cubiclength(i);
-  }
-  if(cycles) L += cubiclength(n-1);
-  cached_length = L;
-  return cached_length;
+  return arcLengths().length();
 }
 
 double path3::arctime(double goal) const
 {
-  if (cycles) {
-    if (goal == 0 || cached_length == 0) return 0;
-    if (goal < 0)  {
-      const path3 &rp = this->reverse();
-      double result = -rp.arctime(-goal);
-      return result;
-    }
-    if (cached_length > 0 && goal >= cached_length) {
-      Int loops = (Int)(goal / cached_length);
-      goal -= loops*cached_length;
-      return loops*n+arctime(goal);
-    }
-  } else {
-    if (goal <= 0)
-      return 0;
-    if (cached_length > 0 && goal >= cached_length)
-      return n-1;
-  }
-
-  double l,L=0;
-  for (Int i = 0; i < n-1; i++) {
-    l = cubiclength(i,goal);
-    if (l < 0)
-      return (-l+i);
-    else {
-      L += l;
-      goal -= l;
-      if (goal <= 0)
-        return i+1;
-    }
-  }
-  if (cycles) {
-    l = cubiclength(n-1,goal);
-    if (l < 0)
-      return -l+n-1;
-    if (cached_length > 0 && cached_length != L+l) {
-      reportError("arclength != length.\n"
-                  "path3::arclength(double) must have broken semantics.\n"
-                  "Please report this error.");
-    }
-    cached_length = L += l;
-    goal -= l;
-    return arctime(goal)+n;
-  }
-  else {
-    cached_length = L;
-    return length();
-  }
+  return camp::arctime(*this,arcLengths(),goal);
 }
 
 // }}}
@@ -736,8 +723,6 @@ path3 concat(const path3& p1, const path3& p2)
 
   if (n1 == -1) return p2;
   if (n2 == -1) return p1;
-  triple a=p1.point(n1);
-  triple b=p2.point((Int) 0);
 
   mem::vector<solvedKnot3> nodes(n1+n2+1);
 
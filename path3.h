@@ -45,19 +45,24 @@ class path3 : public gc {
   Int n; // The number of knots
 
   mem::vector<solvedKnot3> nodes;
-  mutable double cached_length; // Cache length since path3 is immutable.
+  mutable arcTable *arcs; // Built when first needed; path3 is immutable.
 
   mutable bbox3 box;
   mutable bbox3 times; // Times where minimum and maximum extents are attained.
 
+  void noteKnots() const {
+    mem::noteAllocation(mem::PATHS,nodes.size()*sizeof(solvedKnot3));
+  }
+
 public:
   path3()
-    : cycles(false), n(0), nodes(), cached_length(-1) {}
+    : cycles(false), n(0), nodes(), arcs(0) {}
 
   // Create a path3 of a single point
   path3(triple z, bool = false)
-    : cycles(false), n(1), nodes(1), cached_length(-1)
+    : cycles(false), n(1), nodes(1), arcs(0)
   {
+    noteKnots();
     nodes[0].pre = nodes[0].point = nodes[0].post = z;
     nodes[0].straight = false;
   }
@@ -66,8 +71,9 @@ public:
   // methods such as the guide solver, but should probably not be used by a
   // user of the system unless he knows what he is doing.
   path3(mem::vector<solvedKnot3>& nodes, Int n, bool cycles = false)
-    : cycles(cycles), n(n), nodes(nodes), cached_length(-1)
+    : cycles(cycles), n(n), nodes(nodes), arcs(0)
   {
+    noteKnots();
   }
 
   friend bool operator== (const path3& p, const path3& q)
@@ -77,8 +83,9 @@ public:
 
 public:
   path3(solvedKnot3 n1, solvedKnot3 n2)
-    : cycles(false), n(2), nodes(2), cached_length(-1)
+    : cycles(false), n(2), nodes(2), arcs(0)
   {
+    noteKnots();
     nodes[0] = n1;
     nodes[1] = n2;
     nodes[0].pre = nodes[0].point;
@@ -87,9 +94,11 @@ public:
 
   // Copy constructor
   path3(const path3& p)
-    : cycles(p.cycles), n(p.n), nodes(p.nodes), cached_length(p.cached_length),
+    : cycles(p.cycles), n(p.n), nodes(p.nodes), arcs(p.arcs),
       box(p.box), times(p.times)
-  {}
+  {
+    noteKnots();
+  }
 
   path3 unstraighten() const
   {
@@ -242,7 +251,6 @@ public:
 
   triple preaccel(Int t) const {
     if(!cycles && t <= 0) return triple(0,0,0);
-    triple z0=point(t-1);
     triple c0=postcontrol(t-1);
     triple c1=precontrol(t);
     triple z1=point(t);
@@ -284,6 +292,9 @@ public:
   // Used by picture to determine bounding box.
   bbox3 bounds() const;
 
+  // The bounding box of t*p, found without constructing t*p.
+  bbox3 bounds(const double* t) const;
+
   triple mintimes() const {
     checkEmpty3(n);
     bounds();
@@ -301,7 +312,9 @@ public:
     box.addnonempty(point(i),times,(double) i);
   }
 
-  double cubiclength(Int i, double goal=-1) const;
+  // The table of arc lengths along the path.
+  const arcTable& arcLengths() const;
+
   double arclength () const;
   double arctime (double l) const;
 
@@ -0,0 +1,225 @@
+/*****
+ * peephole.cc
+ *
+ * A peephole optimizer for virtual machine code.  It runs on the code of
+ * each function once translation of the function is finished, fusing
+ * common instruction sequences into the superinstructions listed at the end
+ * of opcodes.h and removing instructions that have no effect.
+ *****/
+
+#include "peephole.h"
+#include "builtin.h"
+
+namespace vm {
+
+namespace {
+
+typedef mem::vector<inst> code_t;
+// For each jump in the code, the index of the instruction it jumps to.
+typedef mem::vector<size_t> targets_t;
+
+bool isJump(inst::opcode op)
+{
+  switch (op) {
+    case inst::jmp:
+    case inst::cjmp:
+    case inst::njmp:
+    case inst::jump_if_not_default:
+    case inst::ltjmp:
+    case inst::lejmp:
+    case inst::gejmp:
+    case inst::gtjmp:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Instructions that push a value and have no other effect.
+bool isPush(inst::opcode op)
+{
+  switch (op) {
+    case inst::varpush:
+    case inst::intpush:
+    case inst::constpush:
+    case inst::pushclosure:
+    case inst::push_default:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The compare-and-branch instruction equivalent to a builtin comparing two
+// integers followed by the conditional jump op, or nop if there is none.
+inst::opcode intJump(bltin b, inst::opcode op)
+{
+  bool onTrue = op == inst::cjmp;
+  if (b == run::intLess)
+    return onTrue ? inst::ltjmp : inst::gejmp;
+  if (b == run::intLessEquals)
+    return onTrue ? inst::lejmp : inst::gtjmp;
+  if (b == run::intGreaterEquals)
+    return onTrue ? inst::gejmp : inst::ltjmp;
+  if (b == run::intGreater)
+    return onTrue ? inst::gtjmp : inst::lejmp;
+  return inst::nop;
+}
+
+// Redirect jumps to unconditional jumps to their final destination.
+void threadJumps(code_t& code, targets_t& to)
+{
+  size_t n = code.size();
+  for (size_t k = 0; k < n; ++k) {
+    if (!isJump(code[k].op))
+      continue;
+    size_t dest = to[k];
+    // Bound the search, in case of an infinite loop.
+    for (size_t steps = 0;
+         dest < n && code[dest].op == inst::jmp && steps < n; ++steps)
+      dest = to[dest];
+    to[k] = dest;
+
+    // Returning does not depend on where the return is.
+    if (code[k].op == inst::jmp && dest < n && code[dest].op == inst::ret)
+      code[k].op = inst::ret;
+  }
+}
+
+// Makes one pass of fusions and removals over the code, returning true if
+// anything changed.
+bool fuse(code_t& code, targets_t& to)
+{
+  size_t n = code.size();
+
+  // Instructions that are entered by a jump cannot be fused with the
+  // instruction before them.
+  mem::vector<bool> entered(n+1, false);
+  for (size_t k = 0; k < n; ++k)
+    if (isJump(code[k].op))
+      entered[to[k]] = true;
+
+  code_t out;
+  targets_t outTo;
+  // Where each instruction ended up; instructions that were removed map to
+  // the instruction that replaced them or followed them.
+  targets_t where(n+1);
+
+  bool changed = false;
+  for (size_t k = 0; k < n;) {
+    where[k] = out.size();
+    inst i = code[k];
+    size_t dest = to[k];
+
+    if (i.op == inst::nop ||
+        (i.op == inst::jmp && dest == k+1)) {
+      ++k;
+      changed = true;
+      continue;
+    }
+
+    size_t used = 1;
+    if (k+1 < n && !entered[k+1]) {
+      const inst& next = code[k+1];
+
+      if (next.op == inst::pop && isPush(i.op)) {
+        where[k+1] = out.size();
+        k += 2;
+        changed = true;
+        continue;
+      }
+
+      if (next.op == inst::pop && i.op == inst::varsave) {
+        i.op = inst::varpop;
+        used = 2;
+      }
+      else if (next.op == inst::pop && i.op == inst::fieldsave) {
+        i.op = inst::fieldpop;
+        used = 2;
+      }
+      else if (i.op == inst::builtin &&
+               (next.op == inst::cjmp || next.op == inst::njmp)) {
+        inst::opcode op = intJump(get<bltin>(i), next.op);
+        if (op != inst::nop) {
+          i.op = op;
+          dest = to[k+1];
+          used = 2;
+        }
+      }
+      else if (i.op == inst::varpush || i.op == inst::fieldpush) {
+        Int first = get<Int>(i);
+        if ((next.op == inst::varpush || next.op == inst::fieldpush) &&
+            packable(first, get<Int>(next))) {
+          Int second = get<Int>(next);
+          if (i.op == inst::varpush && next.op == inst::varpush) {
+            i.op = inst::varpush2;
+            used = 2;
+          }
+          else if (i.op == inst::varpush && next.op == inst::fieldpush) {
+            i.op = inst::varfieldpush;
+            // Only the field access can fail.
+            i.pos = next.pos;
+            used = 2;
+          }
+          else if (i.op == inst::fieldpush && next.op == inst::fieldpush) {
+            i.op = inst::fieldpush2;
+            used = 2;
+          }
+          if (used == 2)
+            i.ref = packOperands(first, second);
+        }
+      }
+    }
+
+    for (size_t j = 1; j < used; ++j)
+      where[k+j] = out.size();
+    if (used > 1)
+      changed = true;
+
+    out.push_back(i);
+    outTo.push_back(dest);
+    k += used;
+  }
+  where[n] = out.size();
+
+  for (size_t k = 0; k < out.size(); ++k)
+    if (isJump(out[k].op))
+      outTo[k] = where[outTo[k]];
+
+  code.swap(out);
+  to.swap(outTo);
+  return changed;
+}
+} // namespace
+
+program *peephole(program *base)
+{
+  code_t code;
+  targets_t to;
+  for (program::label ip = base->begin(); ip != base->end(); ++ip) {
+    code.push_back(*ip);
+    to.push_back(isJump(ip->op) ?
+                 offset(base->begin(), get<program::label>(*ip)) : 0);
+  }
+
+  threadJumps(code, to);
+  while (fuse(code, to))
+    threadJumps(code, to);
+
+  // A varpush followed by a builtin enters it directly.  This must be the
+  // last rewrite, as the builtin has to remain in place.
+  for (size_t k = 0; k+1 < code.size(); ++k)
+    if (code[k].op == inst::varpush && code[k+1].op == inst::builtin)
+      code[k].op = inst::varpush_builtin;
+
+  program *p = new program;
+  for (size_t k = 0; k < code.size(); ++k)
+    p->encode(code[k]);
+  for (size_t k = 0; k < code.size(); ++k)
+    if (isJump(code[k].op))
+      p->at(k)->ref = p->at(to[k]);
+
+  return p;
+}
+
+} // namespace vm
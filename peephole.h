@@ -0,0 +1,22 @@
+/*****
+ * peephole.h
+ *
+ * A peephole optimizer for virtual machine code.
+ *****/
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "program.h"
+
+namespace vm {
+
+// Returns an equivalent program in which common instruction sequences are
+// fused into superinstructions and redundant instructions are removed.  The
+// code must be complete: the result is a new program, and jumps into the
+// original code are not preserved.
+program *peephole(program *code);
+
+} // namespace vm
+
+#endif
@@ -16,6 +16,7 @@
 #include "drawlayer.h"
 #include "drawsurface.h"
 #include "drawpath3.h"
+#include "gcstats.h"
 
 #ifdef __MSDOS__
 #include "sys/cygwin.h"
@@ -960,6 +961,7 @@ string Outname(const string& prefix, const string& outputformat,
 bool picture::shipout(picture *preamble, const string& Prefix,
                       const string& format, bool wait, bool view)
 {
+  mem::phaseScope phase(mem::SHIPOUT);
   bool keep=getSetting<bool>("keep");
 
   string aux="";
@@ -1354,6 +1356,7 @@ bool picture::shipout3(const string& prefix, const string& format,
                        size_t nlights, triple *lights, double *diffuse,
                        double *specular, bool view)
 {
+  mem::phaseScope phase(mem::RENDER);
   if(getSetting<bool>("interrupt"))
     return true;
 
@@ -1543,6 +1546,7 @@ bool picture::shipout3(const string& prefix, const string& format,
 
 bool picture::shipout3(const string& prefix, const string format)
 {
+  mem::phaseScope phase(mem::SHIPOUT);
   bounds3();
   bool status;
 
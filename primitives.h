@@ -39,3 +39,4 @@ PRIMITIVE(curlSpecifier,CurlSpecifier,curlSpecifier)
 PRIMITIVE(picture,Picture,frame)
 PRIMITIVE(file,File,file)
 PRIMITIVE(code,Code,code)
+PRIMITIVE(stringbuilder,StringBuilder,stringbuilder)
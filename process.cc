@@ -22,6 +22,7 @@
 #include "stack.h"
 #include "runtime.h"
 #include "texfile.h"
+#include "gcstats.h"
 
 #include "process.h"
 
@@ -158,12 +159,17 @@ public:
 bool runRunnable(runnable *r, coenv &e, istack &s, transMode tm=TRANS_NORMAL) {
   e.e.beginScope();
 
-  lambda *codelet= tm==TRANS_INTERACTIVE ?
-    interactiveRunnable(r).transAsCodelet(e) :
-    r->transAsCodelet(e);
+  lambda *codelet;
+  {
+    mem::phaseScope phase(mem::TRANSLATE);
+    codelet= tm==TRANS_INTERACTIVE ?
+      interactiveRunnable(r).transAsCodelet(e) :
+      r->transAsCodelet(e);
+  }
   em.sync();
   if(!em.errors()) {
     if(getSetting<bool>("translate")) print(cout,codelet->code);
+    mem::phaseScope phase(mem::RUN);
     s.run(codelet);
 
     // Commits the changes made to the environment.
@@ -340,6 +346,9 @@ void ifile::process(bool purge) {
   } catch(handled_error const&) {
   }
 
+  if(getSetting<bool>("prefetch"))
+    parser::prefetch(filename);
+
   if (verbose >= 1)
     cout << "Processing " << outname << endl;
 
@@ -349,6 +358,8 @@ void ifile::process(bool purge) {
   catch(handled_error const&) {
     em.statusError();
   }
+
+  parser::endPrefetch();
 }
 
 // Add a semi-colon terminator, if one is not there.
@@ -884,6 +895,19 @@ void doUnrestrictedList() {
   e.e.list(0);
 }
 
+void preloadModules() {
+  try {
+    penv pe;
+    for(int ind=0; ind < numArgs(); ind++) {
+      string name=getArg(ind);
+      pe.ge().getModule(symbol::trans(name), name);
+    }
+  } catch(handled_error const&) {
+    em.statusError();
+  }
+  em.sync();
+}
+
 // Environment class used by external programs linking to the shared library.
 class fullenv : public gc {
   penv pe;
@@ -46,6 +46,10 @@ void runPromptEmbedded(trans::coenv &e, istack &s);
 // Basic listing.
 void doUnrestrictedList();
 
+// Translate the modules named on the command line without running them, so
+// that later files, including those of server jobs, reuse the translations.
+void preloadModules();
+
 template<class T>
 class terminator {
 public:
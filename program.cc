@@ -60,7 +60,8 @@ ostream& operator<< (ostream& out, const item& i)
   if (std::abs(n) < 1000000)
     return out << n;
 
-  if (fabs(x) < 1e30 and fabs(x) > 1e-30)
+  // A NaN would raise a floating-point exception in the comparisons.
+  if (!std::isnan(x) and fabs(x) < 1e30 and fabs(x) > 1e-30)
     return out << x;
 
   return out << "<item " << p << ">";
@@ -114,6 +115,13 @@ void printInst(ostream& out, const program::label& code,
       break;
     }
 
+    case 'p':
+    {
+      Int n = get<Int>(*code);
+      out << " " << firstOperand(n) << " " << secondOperand(n);
+      break;
+    }
+
     case 't':
     {
       item c = code->ref;
@@ -157,15 +165,11 @@ void printInst(ostream& out, const program::label& code,
 
 void print(ostream& out, program *base)
 {
-  program::label code = base->begin();
-  bool active = true;
-  while (active) {
-    if (code->op == inst::ret ||
-        code->op < 0 || code->op >= numOps)
-      active = false;
+  for (program::label code = base->begin(); code != base->end(); ++code) {
     printInst(out, code, base->begin());
     out << '\n';
-    ++code;
+    if (code->op < 0 || code->op >= numOps)
+      break;
   }
 }
 
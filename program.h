@@ -25,8 +25,10 @@ public:
   void encode(inst i);
   label begin();
   label end();
+  label at(size_t where);
   inst &back();
   void pop_back();
+  size_t size();
 private:
   friend class label;
   typedef mem::vector<inst> code_t;
@@ -60,7 +62,7 @@ private:
 void printInst(std::ostream& out, const program::label& code,
                const program::label& base);
 
-// Prints code until a ret opcode is printed.
+// Prints all of the code.
 void print(std::ostream& out, program *base);
 
 // Inline forwarding functions for vm::program
@@ -70,10 +72,14 @@ inline program::label program::end()
 { return label(code.size(), this); }
 inline program::label program::begin()
 { return label(0, this); }
+inline program::label program::at(size_t where)
+{ return label(where, this); }
 inline inst& program::back()
 { return code.back(); }
 inline void program::pop_back()
 { return code.pop_back(); }
+inline size_t program::size()
+{ return code.size(); }
 inline void program::encode(inst i)
 { code.push_back(i); }
 inline inst& program::operator[](size_t n)
@@ -54,4 +54,53 @@ void itemRefAccess::encode(action act, position pos, coder &e, frame *)
   encode(act, pos, e);
 }
 
+/* constAccess */
+void constAccess::encode(action act, position pos, coder &e)
+{
+  switch (act) {
+    case READ:
+      e.encode(inst::constpush, value);
+      break;
+    case WRITE:
+      em.error(pos);
+      em << "constants cannot be modified";
+      break;
+    case CALL:
+      e.encode(inst::constpush, value);
+      e.encode(inst::popcall);
+      break;
+  };
+}
+
+void constAccess::encode(action act, position pos, coder &e, frame *)
+{
+  // Get rid of the useless top frame.
+  e.encode(inst::pop);
+  encode(act, pos, e);
+}
+
+/* bltinRefAccess */
+void bltinRefAccess::encode(action act, position, coder &e)
+{
+  switch (act) {
+    case READ:
+      e.encode(inst::builtin, read);
+      break;
+    case WRITE:
+      e.encode(inst::builtin, write);
+      break;
+    case CALL:
+      e.encode(inst::builtin, read);
+      e.encode(inst::popcall);
+      break;
+  };
+}
+
+void bltinRefAccess::encode(action act, position pos, coder &e, frame *)
+{
+  // Get rid of the useless top frame.
+  e.encode(inst::pop);
+  encode(act, pos, e);
+}
+
 }
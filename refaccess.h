@@ -28,6 +28,35 @@ public:
   void encode(action act, position pos, coder &e, frame *);
 };
 
+// Access refers to a constant, such as pi, whose value is pushed directly so
+// that expressions using it can be folded.
+class constAccess : public access {
+  vm::item value;
+
+public:
+  constAccess(vm::item value)
+    : value(value) {}
+
+  void encode(action act, position pos, coder &e);
+  void encode(action act, position pos, coder &e, frame *);
+};
+
+// Access refers to data that is located when the code is run, such as the
+// current pen, which belongs to the file being processed.  The read builtin
+// pushes the value; the write builtin pops a value, stores it, and pushes it
+// back.
+class bltinRefAccess : public access {
+  vm::bltin read;
+  vm::bltin write;
+
+public:
+  bltinRefAccess(vm::bltin read, vm::bltin write)
+    : read(read), write(write) {}
+
+  void encode(action act, position pos, coder &e);
+  void encode(action act, position pos, coder &e, frame *);
+};
+
 // Access refers to an arbitrary piece of data of type T.
 template <class T>
 class refAccess : public access {
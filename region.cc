@@ -0,0 +1,159 @@
+/*****
+ * region.cc
+ *
+ * Winding numbers of many points relative to the same cyclic paths.
+ *****/
+
+#include <algorithm>
+
+#include "region.h"
+#include "threadpool.h"
+
+namespace camp {
+
+region::region(const std::vector<const path *>& g) : paths(g)
+{
+  for(size_t n=0; n < paths.size(); ++n) {
+    const path& p=*paths[n];
+    if(!p.cyclic())
+      reportError("path is not cyclic");
+    bounds.push_back(p.bounds());
+
+    Int len=p.length();
+    for(Int i=0; i < len; ++i) {
+      double y0=p.point(i).gety(), y1=p.point(i+1).gety();
+      segment s={std::min(y0,y1),std::max(y0,y1),n,i};
+      if(!p.straight(i)) {
+        double c0=p.postcontrol(i).gety(), c1=p.precontrol(i+1).gety();
+        s.bottom=std::min(s.bottom,std::min(c0,c1));
+        s.top=std::max(s.top,std::max(c0,c1));
+      }
+      segments.push_back(s);
+    }
+  }
+
+  std::vector<size_t> s(segments.size());
+  for(size_t k=0; k < s.size(); ++k)
+    s[k]=k;
+  root=build(s);
+}
+
+// Builds the subtree of the segments s, returning its number.
+size_t region::build(std::vector<size_t>& s)
+{
+  if(s.empty()) return 0;
+
+  // Split at the median midpoint, so that each subtree has at most half of
+  // the segments.
+  std::vector<double> mid;
+  for(size_t k : s)
+    mid.push_back(segments[k].bottom+0.5*(segments[k].top-segments[k].bottom));
+  std::nth_element(mid.begin(),mid.begin()+mid.size()/2,mid.end());
+  double center=mid[mid.size()/2];
+
+  std::vector<size_t> below,above;
+  size_t begin=byBottom.size();
+  for(size_t k : s) {
+    if(segments[k].top < center) below.push_back(k);
+    else if(segments[k].bottom > center) above.push_back(k);
+    else byBottom.push_back(k);
+  }
+  size_t end=byBottom.size();
+  byTop.insert(byTop.end(),byBottom.begin()+begin,byBottom.end());
+  std::sort(byBottom.begin()+begin,byBottom.end(),
+            [this](size_t a, size_t b) {
+              return segments[a].bottom < segments[b].bottom;
+            });
+  std::sort(byTop.begin()+begin,byTop.end(),
+            [this](size_t a, size_t b) {
+              return segments[a].top > segments[b].top;
+            });
+
+  size_t k=nodes.size();
+  node N={center,begin,end,0,0};
+  nodes.push_back(N);
+  s.clear();
+  size_t b=build(below);
+  size_t a=build(above);
+  nodes[k].below=b;
+  nodes[k].above=a;
+  return k+1;
+}
+
+// Calls f(s) for each segment s that spans the height y.
+template<class F>
+void region::stab(double y, F f) const
+{
+  for(size_t k=root; k != 0;) {
+    const node& N=nodes[k-1];
+    if(y < N.center) {
+      for(size_t e=N.begin; e < N.end && segments[byBottom[e]].bottom <= y;
+          ++e)
+        f(segments[byBottom[e]]);
+      k=N.below;
+    } else if(y > N.center) {
+      for(size_t e=N.begin; e < N.end && segments[byTop[e]].top >= y; ++e)
+        f(segments[byTop[e]]);
+      k=N.above;
+    } else {
+      for(size_t e=N.begin; e < N.end; ++e)
+        f(segments[byBottom[e]]);
+      return;
+    }
+  }
+}
+
+Int region::windingnumber(const pair& z, tally& t) const
+{
+  stab(z.gety(),[&](const segment& s) {
+      const bbox& b=bounds[s.n];
+      if(z.getx() < b.left || z.getx() > b.right ||
+         z.gety() < b.bottom || z.gety() > b.top) return;
+
+      if(!t.seen[s.n]) {
+        t.seen[s.n]=true;
+        t.touched.push_back(s.n);
+      }
+      Int& count=t.count[s.n];
+      if(count == undefinedwinding) return;
+
+      const path& p=*paths[s.n];
+      Int i=s.i;
+      if(p.straight(i) ?
+         checkstraight(p.point(i),p.point(i+1),z,count) :
+         checkcurve(p.point(i),p.postcontrol(i),p.precontrol(i+1),
+                    p.point(i+1),z,count,maxdepth))
+        count=undefinedwinding;
+    });
+
+  Int count=0;
+  for(size_t n : t.touched) {
+    count += t.count[n];
+    t.count[n]=0;
+    t.seen[n]=false;
+  }
+  t.touched.clear();
+  return count;
+}
+
+Int region::windingnumber(const pair& z) const
+{
+  tally t(paths.size());
+  return windingnumber(z,t);
+}
+
+void region::windingnumbers(std::vector<Int>& w,
+                            const std::vector<pair>& z) const
+{
+  static const size_t block=1024;
+  size_t n=z.size();
+  w.resize(n);
+  parallelFor((n+block-1)/block,[&](size_t k) {
+      tally t(paths.size());
+      size_t end=std::min(n,(k+1)*block);
+      for(size_t i=k*block; i < end; ++i)
+        w[i]=windingnumber(z[i],t);
+    });
+}
+
+} // namespace camp
@@ -0,0 +1,76 @@
+/*****
+ * region.h
+ *
+ * Cyclic paths prepared for finding the winding numbers of many points, with
+ * their segments indexed by the heights they span.
+ *****/
+
+#ifndef REGION_H
+#define REGION_H
+
+#include <vector>
+
+#include "path.h"
+
+namespace camp {
+
+class region {
+  // Segment i of path n, with control points between heights bottom and
+  // top.  A point outside this range is neither on the segment nor counted
+  // by it.
+  struct segment {
+    double bottom,top;
+    size_t n;
+    Int i;
+  };
+
+  // A node of an interval tree.  The segments that span the height center
+  // are listed by byBottom[begin,end) in increasing order of bottom and by
+  // byTop[begin,end) in decreasing order of top.  The segments below and
+  // above center are in the subtrees below and above, each numbered from one,
+  // with zero for none.
+  struct node {
+    double center;
+    size_t begin,end;
+    size_t below,above;
+  };
+
+  // Per-path tallies of the winding number of one point.
+  struct tally {
+    std::vector<Int> count;
+    std::vector<bool> seen;
+    std::vector<size_t> touched;
+    tally(size_t n) : count(n,0), seen(n,false) {}
+  };
+
+  std::vector<const path *> paths;
+  std::vector<bbox> bounds;
+  std::vector<segment> segments;
+  std::vector<size_t> byBottom,byTop;
+  std::vector<node> nodes;
+  size_t root;
+
+  size_t build(std::vector<size_t>& s);
+
+  template<class F>
+  void stab(double y, F f) const;
+
+  Int windingnumber(const pair& z, tally& t) const;
+
+public:
+  // Prepares the region bounded by the cyclic paths g, which must outlive
+  // it.
+  region(const std::vector<const path *>& g);
+
+  // The sum of the winding numbers of the paths relative to z, each as
+  // computed by path::windingnumber.
+  Int windingnumber(const pair& z) const;
+
+  // Stores in w the winding number relative to each point of z, finding
+  // them in parallel.
+  void windingnumbers(std::vector<Int>& w, const std::vector<pair>& z) const;
+};
+
+} // namespace camp
+
+#endif
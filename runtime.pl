@@ -70,6 +70,11 @@ sub read_types {
     }
 }
 
+# The result types of functions that may be declared pure: their values can
+# be shared by every evaluation of a folded call.
+my %value_types = map { $_ => 1 }
+    qw(bool Int real double pair triple string transform pen);
+
 # Scrape the symbol names of the operators from opsymbols.h.
 my %opsymbols = ();
 open(opsyms, "opsymbols.h") ||
@@ -195,9 +200,10 @@ push @header, "namespace run {\n";
 
 my $count = 0;
 while (<>) {
-  my ($comments,$type,$name,$cname,$params,$code) =
+  my ($comments,$pure,$type,$name,$cname,$params,$code) =
     m|^((?:\s*//[^\n]*\n)*) # comment lines
       \s*
+      (pure\s+)?        # no side effects; may be folded
       (\w*(?:\s*\*)?)   # return type
       \s*
       ([^(:]*)\:*([^(]*) # function name
@@ -224,9 +230,13 @@ while (<>) {
   if (not $type_map{$type}) {
       assoc_error("$prefix.in", $source_line, $type);
   }
+  if ($pure and not $value_types{$type}) {
+      report_error("$prefix.in", $source_line,
+                   "pure function returns '$type', which is not a value type");
+  }
   my @asy_params = asy_params($params, "$prefix.in", $source_line);
   push @builtin, "#line $source_line \"$prefix.in\"\n"
-      . "  addFunc(ve, run::" . $cname
+      . "  " . ($pure ? "addPureFunc" : "addFunc") . "(ve, run::" . $cname
       . ", " . $type_map{$type}
       . ", " . symbolize($name)
       . ( @params ? ", " . join(", ",@asy_params)
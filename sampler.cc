@@ -0,0 +1,551 @@
+/*****
+ * sampler.cc
+ *
+ * A sampling profiler for the virtual machine.
+ *****/
+
+#include <csignal>
+#include <cstring>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+
+#include "sampler.h"
+#include "program.h"
+#include "errormsg.h"
+
+namespace vm {
+
+position getPos();
+
+bool sampling=false;
+bltin runningBuiltin=0;
+
+namespace {
+
+// An entry of the shadow stack: a function being run, the builtin (if any)
+// that called it, and the line of the call.  Functions are numbered in the
+// table of functions, so that the stack holds no pointers to scan.
+struct shadowEntry {
+  size_t func;
+  bltin via;
+  size_t line;
+};
+
+// A frame of a sample: a function and the line being run in it, or a
+// builtin.  A sample is a sequence of frames, outermost first, ended by a
+// frame with neither.
+struct sampleFrame {
+  size_t func;
+  bltin b;
+  size_t line;
+};
+
+const size_t maxDepth=1024;
+
+// Samples are stored in chunks allocated as they fill, each large enough
+// for a sample of the deepest stack.
+const size_t chunkFrames=1 << 14;
+
+struct chunk {
+  size_t used;
+  sampleFrame frames[chunkFrames];
+};
+
+shadowEntry *shadow=0;
+std::atomic<size_t> depth(0);
+
+// The chunks in the order filled.  The handler fills the current chunk and
+// moves on to the spare one, which the virtual machine replaces, as the
+// handler cannot allocate.
+mem::vector<chunk *> *chunks=0;
+chunk *current=0;
+chunk *volatile spare=0;
+std::atomic<size_t> dropped(0);
+
+// The functions sampled, numbered from 1.
+typedef mem::unordered_map<lambda *,size_t> functionIndex_t;
+functionIndex_t *functionIndex=0;
+mem::vector<lambda *> *sampledFunctions=0;
+
+#ifdef HAVE_PTHREAD
+pthread_t sampledThread;
+#endif
+
+Int samplingRate=0;
+double startTime=0.0, stopTime=0.0;
+
+double processorTime()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF,&usage);
+  return usage.ru_utime.tv_sec+usage.ru_stime.tv_sec+
+    1e-6*(usage.ru_utime.tv_usec+usage.ru_stime.tv_usec);
+}
+
+typedef mem::map<bltin,string> bltinNames_t;
+bltinNames_t *bltinNames=0;
+
+inline void barrier()
+{
+  // Order the writes of the virtual machine with respect to the handler,
+  // which runs on the same thread.
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+chunk *newChunk()
+{
+  chunk *c=new(PointerFreeGC) chunk;
+  c->used=0;
+  chunks->push_back(c);
+  return c;
+}
+
+// Provides a spare chunk once the handler has taken the last one.
+inline void refill()
+{
+  if(!spare) {
+    chunk *c=newChunk();
+    barrier();
+    spare=c;
+  }
+}
+
+size_t functionNumber(lambda *l)
+{
+  if(!l)
+    return 0;
+  functionIndex_t::iterator p=functionIndex->find(l);
+  if(p != functionIndex->end())
+    return p->second;
+  size_t n=sampledFunctions->size();
+  sampledFunctions->push_back(l);
+  (*functionIndex)[l]=n;
+  return n;
+}
+
+inline void add(size_t func, bltin b, size_t line)
+{
+  sampleFrame& f=current->frames[current->used++];
+  f.func=func;
+  f.b=b;
+  f.line=line;
+}
+
+void takeSample(int)
+{
+#ifdef HAVE_PTHREAD
+  // The timer of the process may interrupt any of its threads.
+  if(!pthread_equal(pthread_self(),sampledThread)) {
+    pthread_kill(sampledThread,SIGPROF);
+    return;
+  }
+#endif
+  size_t n=std::min(depth.load(std::memory_order_relaxed),maxDepth);
+  barrier();
+  if(current->used+2*n+2 > chunkFrames) {
+    chunk *c=spare;
+    if(!c) {
+      dropped.fetch_add(1,std::memory_order_relaxed);
+      return;
+    }
+    spare=0;
+    current=c;
+  }
+
+  size_t here=getPos().Line();
+  for(size_t i=0; i < n; ++i) {
+    shadowEntry& e=shadow[i];
+    if(e.via)
+      add(0,e.via,0);
+    add(e.func,0,i+1 < n ? shadow[i+1].line : here);
+  }
+  if(runningBuiltin)
+    add(0,runningBuiltin,0);
+  add(0,0,0);
+}
+
+bool setTimer(Int rate)
+{
+  itimerval timer;
+  timer.it_interval.tv_sec=0;
+  timer.it_interval.tv_usec=rate > 0 ? std::max(1000000/rate,(Int) 1) : 0;
+  timer.it_value=timer.it_interval;
+  return setitimer(ITIMER_PROF,&timer,0) == 0;
+}
+
+// A frame as reported: a function and its file, and a line of that file.
+struct location {
+  string name;
+  string file;
+  size_t startLine;
+  size_t line;
+
+  bool operator< (const location& other) const {
+    if(name != other.name) return name < other.name;
+    if(file != other.file) return file < other.file;
+    if(startLine != other.startLine) return startLine < other.startLine;
+    return line < other.line;
+  }
+};
+
+location locate(const sampleFrame& f)
+{
+  location l;
+  if(f.func) {
+    lambda *func=(*sampledFunctions)[f.func];
+    l.name=func->name.empty() ? string("<anonymous>") : func->name;
+    program::label begin=func->code->begin();
+    if(begin != func->code->end()) {
+      l.file=begin->pos.filename();
+      l.startLine=begin->pos.Line();
+    } else
+      l.startLine=0;
+  } else {
+    bltinNames_t::iterator p=bltinNames->find(f.b);
+    if(p != bltinNames->end())
+      l.name=p->second;
+    else {
+      ostringstream buf;
+      buf << "<builtin " << (void *) f.b << ">";
+      l.name=buf.str();
+    }
+    // Builtins are reported without positions, so that their calls from
+    // different lines are merged.
+    l.file="";
+    l.startLine=l.line=0;
+    return l;
+  }
+  l.line=f.line;
+  return l;
+}
+
+typedef mem::vector<size_t> stack_t;
+typedef std::map<stack_t,size_t> counts_t;
+
+// Collapsed stacks: one line per distinct stack, with its frames outermost
+// first, separated by semicolons, followed by the number of samples.
+void writeFolded(const string& name, const mem::vector<location>& locations,
+                 const counts_t& counts)
+{
+  std::ofstream out(name.c_str());
+  for(counts_t::const_iterator p=counts.begin(); p != counts.end(); ++p) {
+    const stack_t& s=p->first;
+    for(size_t i=0; i < s.size(); ++i) {
+      const location& l=locations[s[i]];
+      if(i > 0) out << ";";
+      out << l.name;
+      if(!l.file.empty())
+        out << " " << l.file << ":" << l.line;
+    }
+    out << " " << p->second << "\n";
+  }
+  if(!out)
+    cerr << "cannot write profile " << name << endl;
+}
+
+// A minimal encoder for the protocol buffers of the pprof profile format.
+class protobuf {
+  std::string buf;
+public:
+  void varint(unsigned long long n) {
+    while(n >= 0x80) {
+      buf.push_back((char) (n | 0x80));
+      n >>= 7;
+    }
+    buf.push_back((char) n);
+  }
+  void key(int field, int wiretype) {
+    varint(((unsigned long long) field << 3) | wiretype);
+  }
+  void integer(int field, unsigned long long n) {
+    key(field,0);
+    varint(n);
+  }
+  void bytes(int field, const std::string& s) {
+    key(field,2);
+    varint(s.size());
+    buf += s;
+  }
+  void message(int field, const protobuf& m) {
+    bytes(field,m.buf);
+  }
+  void packed(int field, const mem::vector<unsigned long long>& v) {
+    protobuf p;
+    for(size_t i=0; i < v.size(); ++i)
+      p.varint(v[i]);
+    bytes(field,p.buf);
+  }
+  const std::string& str() const {return buf;}
+};
+
+class stringTable {
+  std::map<std::string,size_t> index;
+public:
+  mem::vector<std::string> strings;
+  stringTable() {(*this)("");}
+  size_t operator()(const std::string& s) {
+    std::map<std::string,size_t>::iterator p=index.find(s);
+    if(p != index.end())
+      return p->second;
+    size_t n=strings.size();
+    index[s]=n;
+    strings.push_back(s);
+    return n;
+  }
+};
+
+// pprof drops anything in angle brackets from a name, as it would the
+// arguments of a C++ template, so such names are reported in parentheses.
+std::string pprofName(const string& name)
+{
+  std::string s(name.c_str());
+  if(s.size() > 1 && s[0] == '<' && s[s.size()-1] == '>') {
+    s[0]='(';
+    s[s.size()-1]=')';
+  }
+  return s;
+}
+
+protobuf valueType(stringTable& strings, const char *type, const char *unit)
+{
+  protobuf v;
+  v.integer(1,strings(type));
+  v.integer(2,strings(unit));
+  return v;
+}
+
+// The processor time per sample.  The timer fires at most once per clock
+// tick, so this is measured rather than taken from the rate requested.
+unsigned long long samplePeriod()
+{
+  size_t n=dropped;
+  for(size_t i=0; i < chunks->size(); ++i) {
+    const chunk& c=*(*chunks)[i];
+    for(size_t j=0; j < c.used; ++j)
+      if(!c.frames[j].func && !c.frames[j].b)
+        ++n;
+  }
+  double seconds=stopTime-startTime;
+  return n > 0 && seconds > 0 ? (unsigned long long) (seconds*1e9/n) :
+    1000000000ULL/samplingRate;
+}
+
+void writePprof(const string& name, const mem::vector<location>& locations,
+                const counts_t& counts)
+{
+  stringTable strings;
+  protobuf profile;
+
+  profile.message(1,valueType(strings,"samples","count"));
+  profile.message(1,valueType(strings,"cpu","nanoseconds"));
+  unsigned long long period=samplePeriod();
+
+  // pprof lists the frames of a sample innermost first.  Location and
+  // function identifiers must be nonzero.
+  for(counts_t::const_iterator p=counts.begin(); p != counts.end(); ++p) {
+    const stack_t& s=p->first;
+    mem::vector<unsigned long long> ids, values;
+    for(size_t i=s.size(); i > 0; --i)
+      ids.push_back(s[i-1]+1);
+    values.push_back(p->second);
+    values.push_back(p->second*period);
+    protobuf sample;
+    sample.packed(1,ids);
+    sample.packed(2,values);
+    profile.message(2,sample);
+  }
+
+  std::map<location,size_t> functions;
+  for(size_t i=0; i < locations.size(); ++i) {
+    location f=locations[i];
+    f.line=0;
+    std::map<location,size_t>::iterator p=functions.find(f);
+    size_t id;
+    if(p == functions.end()) {
+      id=functions.size()+1;
+      functions[f]=id;
+      protobuf function;
+      function.integer(1,id);
+      function.integer(2,strings(pprofName(f.name)));
+      function.integer(3,strings(pprofName(f.name)));
+      function.integer(4,strings(f.file.c_str()));
+      function.integer(5,f.startLine);
+      profile.message(5,function);
+    } else
+      id=p->second;
+
+    protobuf line;
+    line.integer(1,id);
+    line.integer(2,locations[i].line);
+    protobuf loc;
+    loc.integer(1,i+1);
+    loc.message(4,line);
+    profile.message(4,loc);
+  }
+
+  profile.message(11,valueType(strings,"cpu","nanoseconds"));
+  profile.integer(12,period);
+
+  for(size_t i=0; i < strings.strings.size(); ++i)
+    profile.bytes(6,strings.strings[i]);
+
+  gzFile out=gzopen(name.c_str(),"wb");
+  const std::string& data=profile.str();
+  if(!out || gzwrite(out,data.data(),data.size()) != (int) data.size())
+    cerr << "cannot write profile " << name << endl;
+  if(out)
+    gzclose(out);
+}
+
+} // namespace
+
+void nameBuiltin(bltin b, const string& name)
+{
+  if(bltinNames && bltinNames->find(b) == bltinNames->end())
+    (*bltinNames)[b]=name;
+}
+
+void enterFunction(lambda *l)
+{
+  refill();
+  size_t d=depth.load(std::memory_order_relaxed);
+  if(d < maxDepth) {
+    shadowEntry& e=shadow[d];
+    e.func=functionNumber(l);
+    e.via=runningBuiltin;
+    e.line=getPos().Line();
+  }
+  runningBuiltin=0;
+  barrier();
+  depth.store(d+1,std::memory_order_relaxed);
+}
+
+void leaveFunction()
+{
+  size_t d=depth.load(std::memory_order_relaxed);
+  if(d == 0)
+    return;
+  depth.store(--d,std::memory_order_relaxed);
+  barrier();
+  runningBuiltin=d < maxDepth ? shadow[d].via : 0;
+}
+
+void blockSampling()
+{
+#ifdef HAVE_PTHREAD
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set,SIGPROF);
+  pthread_sigmask(SIG_BLOCK,&set,0);
+#endif
+}
+
+void startSampling(Int rate)
+{
+  if(sampling || rate <= 0)
+    return;
+
+  // Only the table of functions refers to collected memory, so the shadow
+  // stack and the samples are not scanned.
+  if(!shadow) {
+    shadow=new(PointerFreeGC) shadowEntry[maxDepth];
+    chunks=new mem::vector<chunk *>;
+    functionIndex=new functionIndex_t;
+    sampledFunctions=new mem::vector<lambda *>;
+    bltinNames=new bltinNames_t;
+  }
+  chunks->clear();
+  functionIndex->clear();
+  sampledFunctions->clear();
+  sampledFunctions->push_back(0);
+  current=newChunk();
+  spare=0;
+  refill();
+  depth=0;
+  dropped=0;
+  runningBuiltin=0;
+#ifdef HAVE_PTHREAD
+  sampledThread=pthread_self();
+#endif
+  samplingRate=rate;
+  startTime=processorTime();
+
+  struct sigaction action;
+  memset(&action,0,sizeof(action));
+  action.sa_handler=takeSample;
+  sigemptyset(&action.sa_mask);
+  // Do not disturb the system calls of the program being profiled.
+  action.sa_flags=SA_RESTART;
+  if(sigaction(SIGPROF,&action,0) != 0 || !setTimer(rate)) {
+    cerr << "cannot start the profiler" << endl;
+    return;
+  }
+  sampling=true;
+}
+
+void stopSampling(const string& prefix)
+{
+  if(!sampling)
+    return;
+  setTimer(0);
+  stopTime=processorTime();
+  signal(SIGPROF,SIG_IGN);
+  sampling=false;
+
+  // Number the distinct locations and count the distinct stacks.
+  std::map<location,size_t> index;
+  mem::vector<location> locations;
+  counts_t counts;
+  stack_t s;
+  size_t total=0;
+  for(size_t i=0; i < chunks->size(); ++i) {
+    const chunk& c=*(*chunks)[i];
+    for(size_t j=0; j < c.used; ++j) {
+      const sampleFrame& f=c.frames[j];
+      if(!f.func && !f.b) {
+        if(s.empty()) {
+          location l;
+          l.name="<outside the virtual machine>";
+          l.startLine=l.line=0;
+          std::map<location,size_t>::iterator p=index.find(l);
+          if(p == index.end()) {
+            index[l]=locations.size();
+            s.push_back(locations.size());
+            locations.push_back(l);
+          } else
+            s.push_back(p->second);
+        }
+        ++counts[s];
+        ++total;
+        s.clear();
+        continue;
+      }
+      location l=locate(f);
+      std::map<location,size_t>::iterator p=index.find(l);
+      if(p == index.end()) {
+        index[l]=locations.size();
+        s.push_back(locations.size());
+        locations.push_back(l);
+      } else
+        s.push_back(p->second);
+    }
+  }
+
+  writeFolded(prefix+".folded",locations,counts);
+  writePprof(prefix+".pb.gz",locations,counts);
+
+  size_t lost=dropped;
+  if(lost > 0)
+    cerr << "profiler: " << lost << " of " << total+lost
+         << " samples dropped" << endl;
+  chunks->clear();
+  current=spare=0;
+}
+
+} // namespace vm
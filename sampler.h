@@ -0,0 +1,78 @@
+/*****
+ * sampler.h
+ *
+ * A sampling profiler for the virtual machine.  Unlike the profiler of
+ * profiler.h, it is always compiled in and costs nothing until it is
+ * started: a SIGPROF timer then records the functions and the builtin being
+ * run, which the virtual machine tracks on a shadow stack.
+ *****/
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "common.h"
+#include "inst.h"
+
+namespace vm {
+
+// Set while the profiler is running.
+extern bool sampling;
+
+// Starts taking rate samples a second of processor time.
+void startSampling(Int rate);
+
+// Stops taking samples and writes them to prefix.folded, as collapsed stacks
+// for flamegraph.pl, and to prefix.pb.gz, for pprof.
+void stopSampling(const string& prefix);
+
+// Gives the name to report for a builtin function.
+void nameBuiltin(bltin b, const string& name);
+
+void enterFunction(lambda *l);
+void leaveFunction();
+
+// Keeps the profiling timer from interrupting the calling thread, for
+// threads other than that of the virtual machine.
+void blockSampling();
+
+// The builtin being run, if any.
+extern bltin runningBuiltin;
+
+// Tracks the function being run by the virtual machine.
+class sampledCall {
+  bool active;
+
+public:
+  sampledCall(lambda *l)
+    : active(sampling) {
+    if (active)
+      enterFunction(l);
+  }
+
+  ~sampledCall() {
+    if (active)
+      leaveFunction();
+  }
+};
+
+// Tracks the builtin being run by the virtual machine.
+class sampledBuiltin {
+  bool active;
+  bltin caller;
+
+public:
+  sampledBuiltin(bltin b)
+    : active(sampling), caller(runningBuiltin) {
+    if (active)
+      runningBuiltin = b;
+  }
+
+  ~sampledBuiltin() {
+    if (active)
+      runningBuiltin = caller;
+  }
+};
+
+} // namespace vm
+
+#endif
@@ -0,0 +1,235 @@
+/*****
+ * segmentgrid.h
+ *
+ * Intersections of each path of one array with each path of another, tested
+ * only for the pairs of paths with segments whose bounding boxes meet.
+ *****/
+
+#ifndef SEGMENTGRID_H
+#define SEGMENTGRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "common.h"
+#include "threadpool.h"
+#include "pair.h"
+#include "triple.h"
+
+namespace camp {
+
+inline double coordinate(const pair& z, size_t d)
+{
+  return d == 0 ? z.getx() : z.gety();
+}
+
+inline double coordinate(const triple& z, size_t d)
+{
+  return d == 0 ? z.getx() : d == 1 ? z.gety() : z.getz();
+}
+
+// The bounding box of the control points of a segment of path n.
+template<size_t D>
+struct segmentBox {
+  double min[D],max[D];
+  size_t n;
+};
+
+// Appends the boxes of the segments of p, or of its point if p has no
+// segments, to boxes.
+template<size_t D, class Path>
+void addSegmentBoxes(std::vector<segmentBox<D> >& boxes, const Path& p,
+                     size_t n)
+{
+  Int length=p.length();
+  if(length < 0) return;
+  for(Int i=0; i < std::max(length,(Int) 1); ++i) {
+    segmentBox<D> b;
+    b.n=n;
+    for(size_t d=0; d < D; ++d) {
+      double z[]={coordinate(p.point(i),d),coordinate(p.postcontrol(i),d),
+                  coordinate(p.precontrol(i+1),d),
+                  coordinate(p.point(i+1),d)};
+      if(length == 0) z[1]=z[2]=z[3]=z[0];
+      b.min[d]=*std::min_element(z,z+4);
+      b.max[d]=*std::max_element(z,z+4);
+    }
+    boxes.push_back(b);
+  }
+}
+
+// Whether the boxes a and b come within fuzz of each other.
+template<size_t D>
+bool overlap(const segmentBox<D>& a, const segmentBox<D>& b, double fuzz)
+{
+  for(size_t d=0; d < D; ++d)
+    if(a.max[d]+fuzz < b.min[d] || b.max[d]+fuzz < a.min[d])
+      return false;
+  return true;
+}
+
+// A uniform grid of about one cell for each box, each cell listing the
+// boxes that meet it.
+template<size_t D>
+class segmentGrid {
+  const std::vector<segmentBox<D> >& boxes;
+  double lo[D],width[D];
+  size_t cells[D];
+
+  // The boxes listed by cell k are entries[start[k]] to entries[start[k+1]).
+  std::vector<size_t> start;
+  std::vector<size_t> entries;
+
+  size_t cell(double x, size_t d) const {
+    if(width[d] == 0.0) return 0;
+    double c=std::floor((x-lo[d])/width[d]);
+    return !(c > 0.0) ? 0 : c >= cells[d]-1 ? cells[d]-1 : (size_t) c;
+  }
+
+  // Calls f(k) for each cell k with coordinates between first and last.
+  template<class F>
+  void forCells(const size_t first[], const size_t last[], F f) const {
+    size_t c[D];
+    std::copy(first,first+D,c);
+    for(;;) {
+      size_t k=0;
+      for(size_t d=D; d-- > 0;)
+        k=k*cells[d]+c[d];
+      f(k);
+      size_t d=0;
+      while(d < D && c[d] == last[d]) {
+        c[d]=first[d];
+        ++d;
+      }
+      if(d == D) return;
+      ++c[d];
+    }
+  }
+
+  void range(size_t first[], size_t last[], const segmentBox<D>& b,
+             double fuzz) const {
+    for(size_t d=0; d < D; ++d) {
+      first[d]=cell(b.min[d]-fuzz,d);
+      last[d]=cell(b.max[d]+fuzz,d);
+    }
+  }
+
+public:
+  segmentGrid(const std::vector<segmentBox<D> >& boxes) : boxes(boxes) {
+    size_t n=boxes.size();
+    size_t perAxis=std::max((size_t) 1,
+                            (size_t) std::ceil(std::pow((double) n,1.0/D)));
+    size_t total=1;
+    for(size_t d=0; d < D; ++d) {
+      double hi=lo[d]=n > 0 ? boxes[0].min[d] : 0.0;
+      for(size_t i=0; i < n; ++i) {
+        lo[d]=std::min(lo[d],boxes[i].min[d]);
+        hi=std::max(hi,boxes[i].max[d]);
+      }
+      cells[d]=hi > lo[d] ? perAxis : 1;
+      width[d]=(hi-lo[d])/cells[d];
+      total *= cells[d];
+    }
+
+    start.assign(total+1,0);
+    size_t first[D],last[D];
+    for(size_t i=0; i < n; ++i) {
+      range(first,last,boxes[i],0.0);
+      forCells(first,last,[this](size_t k) {++start[k+1];});
+    }
+    for(size_t k=0; k < total; ++k)
+      start[k+1] += start[k];
+    entries.resize(start[total]);
+    std::vector<size_t> fill(start.begin(),start.end()-1);
+    for(size_t i=0; i < n; ++i) {
+      range(first,last,boxes[i],0.0);
+      forCells(first,last,[&](size_t k) {entries[fill[k]++]=i;});
+    }
+  }
+
+  // Calls f(n), possibly more than once, for each path n with a box within
+  // fuzz of b.
+  template<class F>
+  void query(const segmentBox<D>& b, double fuzz, F f) const {
+    if(entries.empty()) return;
+    size_t first[D],last[D];
+    range(first,last,b,fuzz);
+    forCells(first,last,[&](size_t k) {
+        for(size_t e=start[k]; e < start[k+1]; ++e) {
+          const segmentBox<D>& c=boxes[entries[e]];
+          if(overlap(b,c,fuzz))
+            f(c.n);
+        }
+      });
+  }
+};
+
+// Appends to pairs, in order, the pairs (i,j) such that a segment of path i
+// of the first array has a box within fuzz of that of a segment of path j of
+// the second, the boxes of which are indexed by grid.
+template<size_t D>
+void candidatePairs(std::vector<std::pair<size_t,size_t> >& pairs,
+                    const std::vector<segmentBox<D> >& a,
+                    const segmentGrid<D>& grid, size_t m, double fuzz)
+{
+  std::vector<size_t> seen(m,0);
+  std::vector<size_t> found;
+  for(size_t k=0; k < a.size();) {
+    size_t i=a[k].n;
+    found.clear();
+    for(; k < a.size() && a[k].n == i; ++k)
+      grid.query(a[k],fuzz,[&](size_t j) {
+          if(seen[j] != i+1) {
+            seen[j]=i+1;
+            found.push_back(j);
+          }
+        });
+    std::sort(found.begin(),found.end());
+    for(size_t j : found)
+      pairs.push_back(std::make_pair(i,j));
+  }
+}
+
+// An intersection at time s of path i of one array and time t of path j of
+// another.
+struct pathIntersection {
+  size_t i,j;
+  double s,t;
+};
+
+// Finds the intersections of each path of a with each path of b whose
+// segments have boxes within fuzz of each other, by calling
+// times(i,j,S,T) for each such pair in parallel.  The intersections are
+// returned ordered by i and j, in the order found by times.
+template<size_t D, class Path, class Times>
+void arrayIntersections(std::vector<pathIntersection>& hits,
+                        const std::vector<Path *>& a,
+                        const std::vector<Path *>& b, double fuzz,
+                        Times times)
+{
+  std::vector<segmentBox<D> > A,B;
+  for(size_t i=0; i < a.size(); ++i)
+    addSegmentBoxes<D>(A,*a[i],i);
+  for(size_t j=0; j < b.size(); ++j)
+    addSegmentBoxes<D>(B,*b[j],j);
+
+  std::vector<std::pair<size_t,size_t> > pairs;
+  candidatePairs<D>(pairs,A,segmentGrid<D>(B),b.size(),fuzz);
+
+  size_t n=pairs.size();
+  std::vector<std::vector<double> > S(n),T(n);
+  parallelFor(n,[&](size_t k) {
+      times(pairs[k].first,pairs[k].second,S[k],T[k]);
+    });
+
+  for(size_t k=0; k < n; ++k)
+    for(size_t h=0; h < S[k].size(); ++h) {
+      pathIntersection I={pairs[k].first,pairs[k].second,S[k][h],T[k][h]};
+      hits.push_back(I);
+    }
+}
+
+} // namespace camp
+
+#endif
@@ -0,0 +1,194 @@
+/*****
+ * server.cc
+ *
+ * Runs jobs sent over a Unix domain socket, each in a child process forked
+ * from a server that has already translated the commonly used modules.
+ *****/
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#ifndef __MSDOS__
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include "server.h"
+#include "errormsg.h"
+#include "util.h"
+#include "settings.h"
+#include "camperror.h"
+
+namespace server {
+
+#ifndef __MSDOS__
+
+// The largest request accepted from a client.
+const size_t maxRequest=1 << 20;
+
+// Reap finished jobs.
+void reaper(int)
+{
+  int saved=errno;
+  while(waitpid(-1,NULL,WNOHANG) > 0) continue;
+  errno=saved;
+}
+
+void reply(int fd, const string& s)
+{
+  const char *p=s.c_str();
+  size_t n=s.size();
+  while(n > 0) {
+    ssize_t w=write(fd,p,n);
+    if(w < 0) {
+      if(errno == EINTR) continue;
+      return;
+    }
+    p += w;
+    n -= (size_t) w;
+  }
+}
+
+// Read the fields of a request from fd, returning false if it is incomplete.
+bool request(int fd, mem::vector<string>& fields)
+{
+  string buf;
+  char chunk[4096];
+  for(;;) {
+    ssize_t n=read(fd,chunk,sizeof(chunk));
+    if(n < 0) {
+      if(errno == EINTR) continue;
+      return false;
+    }
+    if(n == 0 || buf.size()+n > maxRequest) return false;
+    buf.append(chunk,n);
+
+    // Split off the complete fields; an empty one ends the request.
+    size_t start=0, end;
+    while((end=buf.find('\0',start)) != string::npos) {
+      if(end == start) return !fields.empty();
+      fields.push_back(buf.substr(start,end-start));
+      start=end+1;
+    }
+    buf.erase(0,start);
+  }
+}
+
+// Run one job on the connection fd; this does not return.
+void runJob(int fd, job_t *job)
+{
+  mem::vector<string> fields;
+  if(!request(fd,fields)) {
+    reply(fd,"incomplete request\n");
+    _exit(1);
+  }
+
+  if(chdir(fields[0].c_str()) != 0) {
+    reply(fd,"cannot change to directory '"+fields[0]+"'\n");
+    _exit(1);
+  }
+  startpath=getPath();
+
+  int in=open("/dev/null",O_RDONLY);
+  if(in >= 0) {
+    dup2(in,STDIN_FILENO);
+    close(in);
+  }
+  dup2(fd,STDOUT_FILENO);
+  dup2(fd,STDERR_FILENO);
+  close(fd);
+
+  // The arguments follow the name of the program.
+  mem::vector<char *> argv;
+  argv.push_back(settings::argv0);
+  for(size_t i=1; i < fields.size(); ++i)
+    argv.push_back(const_cast<char *>(fields[i].c_str()));
+  int argc=(int) argv.size();
+  argv.push_back(NULL);
+
+  int status=job(argc,argv.data());
+
+  cout.flush();
+  cerr.flush();
+  fflush(stdout);
+  fflush(stderr);
+  char c=(char) status;
+  reply(STDOUT_FILENO,string(1,c));
+  _exit(status);
+}
+
+void serve(const string& name, job_t *job)
+{
+  sockaddr_un address;
+  memset(&address,0,sizeof(address));
+  address.sun_family=AF_UNIX;
+  if(name.size() >= sizeof(address.sun_path)) {
+    ostringstream buf;
+    buf << "Socket name '" << name << "' is too long";
+    camp::reportError(buf);
+  }
+  strcpy(address.sun_path,name.c_str());
+
+  // Replace only a socket left behind by an earlier server.
+  struct stat info;
+  if(lstat(name.c_str(),&info) == 0) {
+    if(!S_ISSOCK(info.st_mode)) {
+      ostringstream buf;
+      buf << "Refusing to replace '" << name << "', which is not a socket";
+      camp::reportError(buf);
+    }
+    unlink(name.c_str());
+  }
+
+  // Jobs run arbitrary commands as this user, so only this user may connect.
+  int listener=socket(AF_UNIX,SOCK_STREAM,0);
+  mode_t mask=umask(0077);
+  bool bound=listener >= 0 &&
+    bind(listener,(sockaddr *) &address,sizeof(address)) == 0;
+  umask(mask);
+  if(!bound || chmod(name.c_str(),0600) != 0 ||
+     listen(listener,SOMAXCONN) != 0) {
+    ostringstream buf;
+    buf << "Cannot listen on socket '" << name << "': " << strerror(errno);
+    camp::reportError(buf);
+  }
+
+  Signal(SIGCHLD,reaper);
+
+  for(;;) {
+    int fd=accept(listener,NULL,NULL);
+    if(fd < 0) {
+      if(errno != EINTR && errno != ECONNABORTED)
+        perror("accept");
+      continue;
+    }
+
+    pid_t pid=fork();
+    if(pid == 0) {
+      close(listener);
+      // Jobs wait for their own children, such as TeX.
+      Signal(SIGCHLD,SIG_DFL);
+      runJob(fd,job);
+    }
+    if(pid < 0)
+      reply(fd,string("cannot fork: ")+strerror(errno)+"\n");
+    close(fd);
+  }
+}
+
+#else
+
+void serve(const string&, job_t *)
+{
+  camp::reportError("Server mode requires Unix domain sockets");
+}
+
+#endif
+
+} // namespace server
@@ -0,0 +1,30 @@
+/*****
+ * server.h
+ *
+ * Runs jobs sent over a Unix domain socket, each in a child process forked
+ * from a server that has already translated the commonly used modules.
+ *****/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "common.h"
+
+namespace server {
+
+// Runs the command line of a job, returning its exit status.
+typedef int job_t(int argc, char *argv[]);
+
+// Listens on the Unix domain socket name, serving jobs until killed.
+//
+// A client sends a job as a sequence of null-terminated strings: the working
+// directory followed by the command-line arguments, ended by an empty
+// string.  The job runs in a copy-on-write child of the server, so it
+// starts with the modules the server has translated.  Its standard output
+// and standard error are sent back over the connection, followed by a
+// single byte holding its exit status.
+void serve(const string& name, job_t *job);
+
+} // namespace server
+
+#endif
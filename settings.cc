@@ -34,6 +34,7 @@
 #include "refaccess.h"
 #include "pipestream.h"
 #include "array.h"
+#include "gcpolicy.h"
 
 #include "glrender.h"
 
@@ -225,6 +226,13 @@ bool quiet=false;
 // Conserve memory at the expense of speed.
 bool compact;
 
+// Run the virtual machine with the threaded-code interpreter.
+bool threadedcode;
+bool optimize;
+bool fold;
+bool dumpcode;
+bool cachemodules;
+
 // Colorspace conversion flags (stored in global variables for efficiency).
 bool gray;
 bool bw;
@@ -248,6 +256,9 @@ const string standardprefix="out";
 string initdir;
 string historyname;
 
+// The free space divisor given by -divisor, if any.
+Int divisor=0;
+
 // Local versions of the argument list.
 int argCount = 0;
 char **argList = 0;
@@ -710,13 +721,36 @@ struct alignSetting : public argumentSetting {
   }
 };
 
+struct gcpolicySetting : public argumentSetting {
+  gcpolicySetting(string name, char code,
+                  string argname, string desc,
+                  string defaultValue)
+    : argumentSetting(name, code, argname, description(desc,defaultValue),
+                      types::primString(), (item)defaultValue) {}
+
+  bool getOption() {
+    string str=optarg;
+    if(mem::gcPolicyNamed(str)) {
+      value=str;
+      return true;
+    }
+    error("invalid argument for option");
+    return false;
+  }
+};
+
 struct stringArraySetting : public itemSetting {
   stringArraySetting(string name, array *defaultValue)
     : itemSetting(name, 0, "", "",
-                  types::stringArray(), (item) defaultValue) {}
+                  types::stringArray(), (item) defaultValue) {reset();}
   bool hide() {return true;}
 
   bool getOption() {return true;}
+
+  // Give each file its own copy of the default, which it may modify.
+  void reset() {
+    value=vm::get<array *>(defaultValue)->copyToDepth(1);
+  }
 };
 
 struct engineSetting : public argumentSetting {
@@ -1076,9 +1110,9 @@ struct divisorOption : public option {
 
   bool getOption() {
     try {
+      divisor=lexical::cast<Int>(optarg);
 #ifdef USEGC
-      Int n=lexical::cast<Int>(optarg);
-      if(n > 0) GC_set_free_space_divisor((GC_word) n);
+      if(divisor > 0) GC_set_free_space_divisor((GC_word) divisor);
 #endif
     } catch (lexical::bad_cast&) {
       error("option requires an int as an argument");
@@ -1198,6 +1232,15 @@ void initSettings() {
     initialize=false;
   }
 
+  // Translated modules refer to the settings module, so it is kept for later
+  // files, with each setting restored to its default value.
+  if(settingsModule) {
+    for(optionsMap_t::iterator opt=optionsMap.begin(); opt != optionsMap.end();
+        ++opt)
+      opt->second->reset();
+    return;
+  }
+
   settingsModule=new types::dummyRecord(symbol::trans("settings"));
 
 // Default mouse bindings
@@ -1325,6 +1368,21 @@ void initSettings() {
   // Resolve ambiguity with --version
   addOption(new incrementOption("vv", 0,"", &verbose,2));
   addOption(new incrementOption("novv", 0,"", &verbose,-2));
+  addOption(new boolrefSetting("threadedcode", 0,
+                               "Use threaded-code dispatch in the virtual machine",
+                               &threadedcode, true));
+  addOption(new boolrefSetting("optimize", 0,
+                               "Apply peephole optimizations to virtual machine code",
+                               &optimize, false));
+  addOption(new boolrefSetting("fold", 0,
+                               "Fold constant expressions and drop unreachable code",
+                               &fold, true));
+  addOption(new boolrefSetting("dumpcode", 0,
+                               "Print the virtual machine code of each function",
+                               &dumpcode, false));
+  addOption(new boolrefSetting("cachemodules", 0,
+                               "Reuse unchanged translated modules across files",
+                               &cachemodules, true));
 
   addOption(new boolSetting("keep", 'k', "Keep intermediate files"));
   addOption(new boolSetting("keepaux", 0,
@@ -1390,6 +1448,16 @@ void initSettings() {
                                      "Alternative output directory/file prefix"));
   addOption(new stringOption("cd", 0, "directory", "Set current directory",
                              &startpath));
+  addSecureSetting(new stringSetting("server", 0, "socket",
+                                     "Serve jobs over a Unix domain socket"));
+  addSecureSetting(new stringSetting("profile", 0, "prefix",
+                                     "Write sampled profiles to prefix.folded and prefix.pb.gz"));
+  addOption(new IntSetting("profilerate", 0, "n",
+                           "Profiler samples per second of processor time",
+                           1000));
+  addOption(new boolSetting("gcstats", 0,
+                            "Report heap size, collections, and allocations on exit",
+                            false));
 
 #ifdef USEGC
   addOption(new compactSetting("compact", 0,
@@ -1398,6 +1466,12 @@ void initSettings() {
   addOption(new divisorOption("divisor", 0, "n",
                               "Garbage collect using purge(divisor=n) [2]"));
 #endif
+  addOption(new gcpolicySetting("gcpolicy", 0, "name",
+                                "Garbage collection policy: default, throughput, footprint, or parallel",
+                                GetEnv("gcpolicy","default")));
+  addOption(new boolSetting("presize", 0,
+                            "Size the heap to the peak of the previous run",
+                            false));
 
   addOption(new stringSetting("prompt", 0,"str","Prompt","> "));
   addOption(new stringSetting("prompt2", 0,"str",
@@ -1434,6 +1508,9 @@ void initSettings() {
   addOption(new boolSetting("autoplain", 0,
                             "Enable automatic importing of plain",
                             true));
+  addOption(new boolSetting("prefetch", 0,
+                            "Read imported modules in the background",
+                            true));
   addOption(new boolSetting("autorotate", 0,
                             "Enable automatic PDF page rotation",
                             false));
@@ -1537,6 +1614,7 @@ void setInteractive()
 
   if(numArgs() == 0 && !getSetting<bool>("listvariables") &&
      getSetting<string>("command").empty() &&
+     getSetting<string>("server").empty() &&
      (isatty(STDIN_FILENO) || xasy || getSetting<Int>("lsp")))
     interact::interactive=true;
 
@@ -1597,6 +1675,10 @@ string lookup(const string& symbol)
   return s;
 }
 
+string heapname() {
+  return initdir+"/heap";
+}
+
 void initDir() {
   if(getSetting<string>("sysdir").empty()) {
     string s=lookup("TEXMFMAIN");
@@ -1887,6 +1969,19 @@ void setOptions(int argc, char *argv[])
   if(verbose == 0 && !getSetting<bool>("debug")) GC_set_warn_proc(no_GCwarn);
 #endif
 
+  string gcpolicy=getSetting<string>("gcpolicy");
+  if(!mem::gcPolicyNamed(gcpolicy))
+    cerr << argv0 << ": unknown garbage collection policy " << gcpolicy
+         << endl;
+  else if(!mem::setGCPolicy(gcpolicy) && verbose > 0)
+    cerr << "Parallel marking is not available; set ASYMPTOTE_GCPOLICY="
+         << gcpolicy << " before starting asy" << endl;
+#ifdef USEGC
+  if(divisor > 0) GC_set_free_space_divisor((GC_word) divisor);
+#endif
+  if(getSetting<bool>("presize"))
+    mem::presizeHeap(heapname());
+
   if(setlocale (LC_ALL, "") == NULL && getSetting<bool>("debug"))
     perror("setlocale");
 
@@ -63,6 +63,9 @@ extern const string standardprefix;
 
 extern string historyname;
 
+// The file in which the peak size of the heap is recorded for -presize.
+string heapname();
+
 void SetPageDimensions();
 
 types::record *getSettingsModule();
@@ -77,6 +80,11 @@ inline T getSetting(string name)
 
 extern Int verbose;
 extern bool compact;
+extern bool threadedcode;
+extern bool optimize;
+extern bool fold;
+extern bool dumpcode;
+extern bool cachemodules;
 extern bool gray;
 extern bool bw;
 extern bool rgb;
@@ -0,0 +1,427 @@
+/*****
+ * simdop.cc
+ *
+ * Vectorized kernels for elementwise operations on arrays of reals.
+ *****/
+
+#include <cstring>
+#include <cmath>
+
+#include "simdop.h"
+#include "array.h"
+
+namespace run {
+namespace simd {
+
+using vm::item;
+using vm::array;
+
+#if COMPACT
+
+// A compact item holding a real is just its IEEE double, so the storage of
+// an array of reals can be processed in place.
+static_assert(sizeof(item) == sizeof(double),
+              "compact items must be the size of a double");
+
+#ifdef __GNUC__
+// The vector helpers below are always inlined, so the ABI for passing
+// vectors between functions compiled for different targets is moot.
+#pragma GCC diagnostic ignored "-Wpsabi"
+#define VECTORIZE 1
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define VECTORIZE 0
+#define ALWAYS_INLINE inline
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__linux__) &&   \
+  (defined(__x86_64__) || defined(__i386__))
+// Build an AVX2 clone of each kernel next to the baseline (SSE2) version;
+// the dynamic loader selects one according to the host CPU.  On ARM64 the
+// baseline already provides NEON.
+#define KERNEL __attribute__((target_clones("avx2","default")))
+#else
+#define KERNEL
+#endif
+
+#if VECTORIZE
+const size_t width=4;
+typedef double vreal __attribute__((vector_size(width*sizeof(double))));
+typedef Int vint __attribute__((vector_size(width*sizeof(Int))));
+
+ALWAYS_INLINE vreal load(const double *x)
+{
+  vreal v;
+  memcpy(&v,x,sizeof(v));
+  return v;
+}
+
+ALWAYS_INLINE vint loadInt(const double *x)
+{
+  vint v;
+  memcpy(&v,x,sizeof(v));
+  return v;
+}
+
+template<class V, class T>
+ALWAYS_INLINE void store(T *x, V v)
+{
+  memcpy(x,&v,sizeof(v));
+}
+
+ALWAYS_INLINE vint splat(Int x)
+{
+  vint v={x,x,x,x};
+  return v;
+}
+
+ALWAYS_INLINE bool any(vint v)
+{
+  return (v[0] | v[1] | v[2] | v[3]) != 0;
+}
+#endif
+
+ALWAYS_INLINE Int bits(const double *x)
+{
+  Int k;
+  memcpy(&k,x,sizeof(k));
+  return k;
+}
+
+// Return true if every element of x is initialized.
+ALWAYS_INLINE bool defined(const double *x, size_t n)
+{
+  const Int undefined=vm::Undefined;
+  size_t i=0;
+#if VECTORIZE
+  vint bad=splat(0);
+  const vint u=splat(undefined);
+  for(; i+width <= n; i += width)
+    bad |= loadInt(x+i) >= u;
+  if(any(bad)) return false;
+#endif
+  for(; i < n; ++i)
+    if(bits(x+i) >= undefined) return false;
+  return true;
+}
+
+// Return true if every element of x is initialized and not a NaN.
+ALWAYS_INLINE bool ordered(const double *x, size_t n)
+{
+  const Int undefined=vm::Undefined;
+  size_t i=0;
+#if VECTORIZE
+  vint bad=splat(0);
+  const vint u=splat(undefined);
+  for(; i+width <= n; i += width) {
+    vreal v=load(x+i);
+    bad |= (loadInt(x+i) >= u) | (v != v);
+  }
+  if(any(bad)) return false;
+#endif
+  for(; i < n; ++i)
+    if(bits(x+i) >= undefined || x[i] != x[i]) return false;
+  return true;
+}
+
+// Return true if no element of x is zero.
+ALWAYS_INLINE bool nonzero(const double *x, size_t n)
+{
+  size_t i=0;
+#if VECTORIZE
+  vint bad=splat(0);
+  const vreal zero={0.0,0.0,0.0,0.0};
+  for(; i+width <= n; i += width)
+    bad |= load(x+i) == zero;
+  if(any(bad)) return false;
+#endif
+  for(; i < n; ++i)
+    if(x[i] == 0.0) return false;
+  return true;
+}
+
+// Operand adaptors presenting either an array or a scalar to the kernels.
+struct packed {
+  const double *x;
+  packed(const double *x) : x(x) {}
+  double operator[](size_t i) const {return x[i];}
+#if VECTORIZE
+  ALWAYS_INLINE vreal vec(size_t i) const {return load(x+i);}
+#endif
+};
+
+struct broadcast {
+  double x;
+#if VECTORIZE
+  vreal v;
+  broadcast(double x) : x(x) {v=vreal{x,x,x,x};}
+  ALWAYS_INLINE vreal vec(size_t) const {return v;}
+#else
+  broadcast(double x) : x(x) {}
+#endif
+  double operator[](size_t) const {return x;}
+};
+
+// These agree elementwise with the operators of mathop.h, including the
+// treatment of NaNs and signed zeros.
+struct Add {
+  template<class V>
+  ALWAYS_INLINE V operator()(V x, V y) const {return x+y;}
+};
+struct Sub {
+  template<class V>
+  ALWAYS_INLINE V operator()(V x, V y) const {return x-y;}
+};
+struct Mul {
+  template<class V>
+  ALWAYS_INLINE V operator()(V x, V y) const {return x*y;}
+};
+struct Div {
+  template<class V>
+  ALWAYS_INLINE V operator()(V x, V y) const {return x/y;}
+};
+struct Min {
+  template<class V>
+  ALWAYS_INLINE V operator()(V x, V y) const {return x < y ? x : y;}
+};
+struct Max {
+  template<class V>
+  ALWAYS_INLINE V operator()(V x, V y) const {return x > y ? x : y;}
+};
+
+struct Less {
+  template<class V>
+  ALWAYS_INLINE auto operator()(V x, V y) const -> decltype(x < y) {
+    return x < y;
+  }
+};
+struct LessEquals {
+  template<class V>
+  ALWAYS_INLINE auto operator()(V x, V y) const -> decltype(x <= y) {
+    return x <= y;
+  }
+};
+struct GreaterEquals {
+  template<class V>
+  ALWAYS_INLINE auto operator()(V x, V y) const -> decltype(x >= y) {
+    return x >= y;
+  }
+};
+struct Greater {
+  template<class V>
+  ALWAYS_INLINE auto operator()(V x, V y) const -> decltype(x > y) {
+    return x > y;
+  }
+};
+struct Equals {
+  template<class V>
+  ALWAYS_INLINE auto operator()(V x, V y) const -> decltype(x == y) {
+    return x == y;
+  }
+};
+struct NotEquals {
+  template<class V>
+  ALWAYS_INLINE auto operator()(V x, V y) const -> decltype(x != y) {
+    return x != y;
+  }
+};
+
+template<class F, class A, class B>
+ALWAYS_INLINE void arith(double *c, A a, B b, size_t n, F f)
+{
+  size_t i=0;
+#if VECTORIZE
+  for(; i+width <= n; i += width)
+    store(c+i,f(a.vec(i),b.vec(i)));
+#endif
+  for(; i < n; ++i)
+    c[i]=f(a[i],b[i]);
+}
+
+// Comparisons store the compact encoding of a bool.
+template<class F, class A, class B>
+ALWAYS_INLINE void compare(Int *c, A a, B b, size_t n, F f)
+{
+  const Int t=vm::BoolTruthValue, u=vm::BoolFalseValue;
+  size_t i=0;
+#if VECTORIZE
+  const vint vt=splat(t), vu=splat(u);
+  for(; i+width <= n; i += width)
+    store(c+i,f(a.vec(i),b.vec(i)) ? vt : vu);
+#endif
+  for(; i < n; ++i)
+    c[i]=f(a[i],b[i]) ? t : u;
+}
+
+template<class A, class B>
+ALWAYS_INLINE bool binary(opcode op, item *c, A a, B b, size_t n)
+{
+  double *x=reinterpret_cast<double *>(c);
+  Int *k=reinterpret_cast<Int *>(c);
+  switch(op) {
+    case ADD: arith(x,a,b,n,Add()); break;
+    case SUB: arith(x,a,b,n,Sub()); break;
+    case MUL: arith(x,a,b,n,Mul()); break;
+    case DIV: arith(x,a,b,n,Div()); break;
+    case MIN: arith(x,a,b,n,Min()); break;
+    case MAX: arith(x,a,b,n,Max()); break;
+    case LT: compare(k,a,b,n,Less()); break;
+    case LE: compare(k,a,b,n,LessEquals()); break;
+    case GE: compare(k,a,b,n,GreaterEquals()); break;
+    case GT: compare(k,a,b,n,Greater()); break;
+    case EQ: compare(k,a,b,n,Equals()); break;
+    case NE: compare(k,a,b,n,NotEquals()); break;
+    default: return false;
+  }
+  return true;
+}
+
+KERNEL
+static bool arrayArrayKernel(opcode op, item *c, const double *a,
+                             const double *b, size_t n)
+{
+  if(!defined(a,n) || !defined(b,n)) return false;
+  if(op == DIV && !nonzero(b,n)) return false;
+  return binary(op,c,packed(a),packed(b),n);
+}
+
+KERNEL
+static bool arrayScalarKernel(opcode op, item *c, const double *a, double b,
+                              size_t n)
+{
+  if(!defined(a,n)) return false;
+  if(op == DIV && b == 0.0) return false;
+  return binary(op,c,packed(a),broadcast(b),n);
+}
+
+KERNEL
+static bool scalarArrayKernel(opcode op, item *c, double a, const double *b,
+                              size_t n)
+{
+  if(!defined(b,n)) return false;
+  if(op == DIV && !nonzero(b,n)) return false;
+  return binary(op,c,broadcast(a),packed(b),n);
+}
+
+KERNEL
+static bool unaryKernel(opcode op, item *c, const double *a, size_t n)
+{
+  if(op != ABS || !defined(a,n)) return false;
+  double *x=reinterpret_cast<double *>(c);
+  size_t i=0;
+#if VECTORIZE
+  const vint mask=splat((Int) (~(unsignedInt) 0 >> 1));
+  for(; i+width <= n; i += width)
+    store(x+i,(vreal) ((vint) load(a+i) & mask));
+#endif
+  for(; i < n; ++i)
+    x[i]=fabs(a[i]);
+  return true;
+}
+
+template<class F>
+ALWAYS_INLINE bool extremum(const double *x, size_t n, F f, double& result)
+{
+  // NaNs make the result depend on the order of evaluation.
+  if(!ordered(x,n)) return false;
+  double m=x[0];
+  size_t i=1;
+#if VECTORIZE
+  if(n >= width) {
+    vreal v=load(x);
+    for(i=width; i+width <= n; i += width)
+      v=f(v,load(x+i));
+    for(size_t j=0; j < width; ++j)
+      m=f(m,v[j]);
+  }
+#endif
+  for(; i < n; ++i)
+    m=f(m,x[i]);
+  // With both signed zeros present the lanes may pick a different one.
+  if(m == 0.0) return false;
+  result=m;
+  return true;
+}
+
+KERNEL
+static bool reduceKernel(opcode op, const double *x, size_t n,
+                         double& result)
+{
+  switch(op) {
+    case ADD: {
+      // The sum is accumulated in order so that it matches the scalar
+      // result exactly; only the validity check is vectorized.
+      if(!defined(x,n)) return false;
+      double sum=0.0;
+      for(size_t i=0; i < n; ++i)
+        sum += x[i];
+      result=sum;
+      return true;
+    }
+    case MIN: return n > 0 && extremum(x,n,Min(),result);
+    case MAX: return n > 0 && extremum(x,n,Max(),result);
+    default: return false;
+  }
+}
+
+inline const double *data(const array *a)
+{
+  return reinterpret_cast<const double *>(a->data());
+}
+
+bool arrayArray(opcode op, array *c, const array *a, const array *b)
+{
+  return arrayArrayKernel(op,c->data(),data(a),data(b),c->size());
+}
+
+bool arrayScalar(opcode op, array *c, const array *a, double b)
+{
+  return arrayScalarKernel(op,c->data(),data(a),b,c->size());
+}
+
+bool scalarArray(opcode op, array *c, double a, const array *b)
+{
+  return scalarArrayKernel(op,c->data(),a,data(b),c->size());
+}
+
+bool unary(opcode op, array *c, const array *a)
+{
+  return unaryKernel(op,c->data(),data(a),c->size());
+}
+
+bool reduce(opcode op, const array *a, double& result)
+{
+  return reduceKernel(op,data(a),a->size(),result);
+}
+
+#else
+
+bool arrayArray(opcode, array *, const array *, const array *)
+{
+  return false;
+}
+
+bool arrayScalar(opcode, array *, const array *, double)
+{
+  return false;
+}
+
+bool scalarArray(opcode, array *, double, const array *)
+{
+  return false;
+}
+
+bool unary(opcode, array *, const array *)
+{
+  return false;
+}
+
+bool reduce(opcode, const array *, double&)
+{
+  return false;
+}
+
+#endif
+
+} // namespace simd
+} // namespace run
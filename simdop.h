@@ -0,0 +1,46 @@
+/*****
+ * simdop.h
+ *
+ * Vectorized kernels for elementwise operations on arrays of reals.
+ *****/
+
+#ifndef SIMDOP_H
+#define SIMDOP_H
+
+#include "common.h"
+
+namespace vm {
+class array;
+}
+
+namespace run {
+namespace simd {
+
+enum opcode {NONE, ADD, SUB, MUL, DIV, MIN, MAX, LT, LE, GE, GT, EQ, NE, ABS};
+
+// Each kernel stores its result in the preallocated array c (of the same
+// size as its operands) and returns true.  A kernel returns false,
+// leaving c unspecified, when the generic loop must handle the operation,
+// for instance to report an uninitialized element or a division by zero
+// at the correct index.
+
+// c[i]=a[i] op b[i].
+bool arrayArray(opcode op, vm::array *c, const vm::array *a,
+                const vm::array *b);
+
+// c[i]=a[i] op b.
+bool arrayScalar(opcode op, vm::array *c, const vm::array *a, double b);
+
+// c[i]=a op b[i].
+bool scalarArray(opcode op, vm::array *c, double a, const vm::array *b);
+
+// c[i]=op(a[i]).
+bool unary(opcode op, vm::array *c, const vm::array *a);
+
+// Fold op over the nonempty array a, as sum, min, or max do.
+bool reduce(opcode op, const vm::array *a, double& result);
+
+} // namespace simd
+} // namespace run
+
+#endif
@@ -0,0 +1,336 @@
+/*****
+ * sortop.cc
+ *
+ * Native sorting and searching of arrays of built-in ordered types.
+ *****/
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "sortop.h"
+#include "array.h"
+#include "callable.h"
+#include "mathop.h"
+#include "runpair.h"
+#include "runtriple.h"
+#include "sampler.h"
+
+namespace run {
+namespace sorting {
+
+using vm::item;
+using vm::array;
+using camp::pair;
+using camp::triple;
+
+namespace {
+
+// Shorter arrays of integers and reals are sorted by comparison.
+const size_t radixThreshold=1024;
+
+// Each thread of a parallel sort is given at least this many elements.
+const size_t minChunk=1 << 15;
+
+// Unsigned keys ordered as the values they are computed from.
+inline uint64_t key(Int i)
+{
+  return (uint64_t) i ^ ((uint64_t) 1 << 63);
+}
+
+inline uint64_t key(double x)
+{
+  if(x == 0.0) x=0.0; // The keys of -0 and 0 must be equal.
+  uint64_t u;
+  memcpy(&u,&x,sizeof(u));
+  return u >> 63 ? ~u : u | ((uint64_t) 1 << 63);
+}
+
+// The values compared under each order.  Reading a value reports an
+// uninitialized cell, so values are read before any thread is started.
+template<order o> struct cell;
+
+template<> struct cell<INT> {
+  typedef Int type;
+  static const bool radix=true;
+  static type value(const item& i) {return vm::get<Int>(i);}
+  static bool less(type a, type b) {return a < b;}
+};
+
+template<> struct cell<REAL> {
+  typedef double type;
+  static const bool radix=true;
+  static type value(const item& i) {return vm::get<double>(i);}
+  static bool less(type a, type b) {return a < b;}
+};
+
+template<> struct cell<STRING> {
+  typedef const string *type;
+  static const bool radix=false;
+  static type value(const item& i) {return vm::get<string*>(i);}
+  static bool less(type a, type b) {return *a < *b;}
+};
+
+template<> struct cell<PAIR> {
+  typedef const pair *type;
+  static const bool radix=false;
+  static type value(const item& i) {return vm::get<pair*>(i);}
+  static bool less(type a, type b) {
+    return a->getx() < b->getx() ||
+      (a->getx() == b->getx() && a->gety() < b->gety());
+  }
+};
+
+template<> struct cell<TRIPLE> {
+  typedef const triple *type;
+  static const bool radix=false;
+  static type value(const item& i) {return vm::get<triple*>(i);}
+  static bool less(type a, type b) {
+    return a->getx() < b->getx() ||
+      (a->getx() == b->getx() && (a->gety() < b->gety() ||
+                                  (a->gety() == b->gety() &&
+                                   a->getz() < b->getz())));
+  }
+};
+
+typedef std::vector<size_t> permutation;
+typedef std::pair<uint64_t,size_t> keyed;
+
+// A stable least-significant-digit radix sort on the keys, a byte at a time,
+// skipping the bytes shared by all keys.
+void radixSort(std::vector<keyed>& a)
+{
+  size_t n=a.size();
+  size_t count[8][256]={};
+  for(const keyed& e : a)
+    for(unsigned b=0; b < 8; ++b)
+      ++count[b][(e.first >> 8*b) & 0xFF];
+
+  std::vector<keyed> t(n);
+  for(unsigned b=0; b < 8; ++b) {
+    size_t *c=count[b];
+    if(c[(a[0].first >> 8*b) & 0xFF] == n)
+      continue;
+    size_t sum=0;
+    for(size_t k=0; k < 256; ++k) {
+      size_t m=c[k];
+      c[k]=sum;
+      sum += m;
+    }
+    for(const keyed& e : a)
+      t[c[(e.first >> 8*b) & 0xFF]++]=e;
+    a.swap(t);
+  }
+}
+
+// Sorts the chunks of a in parallel and then merges them.
+template<class T, class Less>
+void parallelSort(std::vector<T>& a, Less less)
+{
+  size_t n=a.size();
+  size_t threads=std::min((size_t) std::thread::hardware_concurrency(),
+                          n/minChunk);
+  if(threads <= 1) {
+    std::sort(a.begin(),a.end(),less);
+    return;
+  }
+
+  typedef typename std::vector<T>::iterator iterator;
+  size_t chunk=(n+threads-1)/threads;
+  std::vector<std::thread> workers;
+  for(size_t l=0; l < n; l += chunk) {
+    iterator b=a.begin()+l;
+    iterator e=a.begin()+std::min(n,l+chunk);
+    try {
+      workers.emplace_back([=] {
+        vm::blockSampling();
+        std::sort(b,e,less);
+      });
+    } catch(std::system_error&) {
+      std::sort(b,e,less);
+    }
+  }
+  for(std::thread& w : workers)
+    w.join();
+
+  for(size_t width=chunk; width < n; width *= 2)
+    for(size_t l=0; l+width < n; l += 2*width)
+      std::inplace_merge(a.begin()+l,a.begin()+l+width,
+                         a.begin()+std::min(n,l+2*width),less);
+}
+
+template<class C>
+void sortIndices(const array *a, bool stable, permutation& index,
+                 std::false_type)
+{
+  typedef std::pair<typename C::type,size_t> entry;
+  size_t n=a->size();
+  std::vector<entry> e(n);
+  for(size_t i=0; i < n; ++i)
+    e[i]=entry(C::value((*a)[i]),i);
+
+  if(stable)
+    parallelSort(e,[](const entry& x, const entry& y) {
+        return C::less(x.first,y.first) ||
+          (!C::less(y.first,x.first) && x.second < y.second);
+      });
+  else
+    parallelSort(e,[](const entry& x, const entry& y) {
+        return C::less(x.first,y.first);
+      });
+
+  for(size_t i=0; i < n; ++i)
+    index[i]=e[i].second;
+}
+
+template<class C>
+void sortIndices(const array *a, bool stable, permutation& index,
+                 std::true_type)
+{
+  size_t n=a->size();
+  if(n < radixThreshold) {
+    sortIndices<C>(a,stable,index,std::false_type());
+    return;
+  }
+
+  std::vector<keyed> k(n);
+  for(size_t i=0; i < n; ++i)
+    k[i]=keyed(key(C::value((*a)[i])),i);
+  radixSort(k);
+  for(size_t i=0; i < n; ++i)
+    index[i]=k[i].second;
+}
+
+// The indices of the cells of a in sorted order.
+template<class C>
+permutation sorted(const array *a, bool stable)
+{
+  permutation index(a->size());
+  sortIndices<C>(a,stable,index,std::integral_constant<bool,C::radix>());
+  return index;
+}
+
+template<class C>
+void sortCells(array *c, bool stable)
+{
+  permutation index=sorted<C>(c,stable);
+  mem::vector<item> cells;
+  cells.assign(c->begin(),c->end());
+  size_t n=index.size();
+  for(size_t i=0; i < n; ++i)
+    (*c)[i]=cells[index[i]];
+}
+
+template<class C>
+array *argsortCells(const array *a)
+{
+  permutation index=sorted<C>(a,true);
+  size_t n=index.size();
+  array *b=new array(n,PointerFreeGC);
+  for(size_t i=0; i < n; ++i)
+    (*b)[i]=(Int) index[i];
+  return b;
+}
+
+// The index of the last element of a not greater than key, or -1.
+template<class C>
+Int searchCells(const array *a, typename C::type key)
+{
+  size_t l=0, u=a->size();
+  while(l < u) {
+    size_t i=(l+u)/2;
+    if(C::less(key,C::value((*a)[i]))) u=i;
+    else l=i+1;
+  }
+  return (Int) l-1;
+}
+
+template<class C>
+array *searchsortedCells(const array *a, const array *keys)
+{
+  size_t n=keys->size();
+  array *b=new array(n,PointerFreeGC);
+  for(size_t i=0; i < n; ++i)
+    (*b)[i]=searchCells<C>(a,C::value((*keys)[i]));
+  return b;
+}
+
+template<class C>
+array *uniqueCells(const array *a)
+{
+  permutation index=sorted<C>(a,true);
+  array *b=new array(0,a->placement());
+  typename C::type last=typename C::type();
+  for(size_t i=0; i < index.size(); ++i) {
+    const item& x=(*a)[index[i]];
+    typename C::type v=C::value(x);
+    if(i == 0 || C::less(last,v)) {
+      b->push(x);
+      last=v;
+    }
+  }
+  return b;
+}
+
+} // namespace
+
+#define DISPATCH(o,...)                                         \
+  switch(o) {                                                   \
+    case INT: {typedef cell<INT> C; __VA_ARGS__;}               \
+    case REAL: {typedef cell<REAL> C; __VA_ARGS__;}             \
+    case STRING: {typedef cell<STRING> C; __VA_ARGS__;}         \
+    case PAIR: {typedef cell<PAIR> C; __VA_ARGS__;}             \
+    case TRIPLE: {typedef cell<TRIPLE> C; __VA_ARGS__;}         \
+    case NONE: break;                                           \
+  }
+
+order nativeOrder(vm::callable *f)
+{
+  vm::bfunc *b=dynamic_cast<vm::bfunc *>(f);
+  if(b == NULL) return NONE;
+
+  vm::bltin g=b->getBuiltin();
+  if(g == binaryOp<Int,less>) return INT;
+  if(g == binaryOp<double,less>) return REAL;
+  if(g == binaryOp<string,less>) return STRING;
+  if(g == pairLexorder) return PAIR;
+  if(g == tripleLexorder) return TRIPLE;
+  return NONE;
+}
+
+void sort(array *c, order o, bool stable)
+{
+  DISPATCH(o,sortCells<C>(c,stable); return);
+}
+
+array *argsort(const array *a, order o)
+{
+  DISPATCH(o,return argsortCells<C>(a));
+  return NULL;
+}
+
+Int search(const array *a, const item& key, order o)
+{
+  DISPATCH(o,return searchCells<C>(a,C::value(key)));
+  return -1;
+}
+
+array *searchsorted(const array *a, const array *keys, order o)
+{
+  DISPATCH(o,return searchsortedCells<C>(a,keys));
+  return NULL;
+}
+
+array *unique(const array *a, order o)
+{
+  DISPATCH(o,return uniqueCells<C>(a));
+  return NULL;
+}
+
+#undef DISPATCH
+
+} // namespace sorting
+} // namespace run
@@ -0,0 +1,49 @@
+/*****
+ * sortop.h
+ *
+ * Native sorting and searching of arrays of built-in ordered types.
+ *****/
+
+#ifndef SORTOP_H
+#define SORTOP_H
+
+#include "common.h"
+
+namespace vm {
+class array;
+class item;
+class callable;
+}
+
+namespace run {
+namespace sorting {
+
+// The orders sorted natively: < on integers, reals, and strings, and
+// lexorder on pairs and triples.
+enum order {NONE, INT, REAL, STRING, PAIR, TRIPLE};
+
+// The order implemented by the function less, or NONE if less is not one of
+// the built-in comparisons above, in which case it must be called back.
+order nativeOrder(vm::callable *less);
+
+// Sorts the array c in place in ascending order.  Equal elements keep their
+// order if stable is true.  Large arrays of integers and reals are radix
+// sorted; other large arrays are sorted in parallel.
+void sort(vm::array *c, order o, bool stable);
+
+// Returns the indices that stably sort a.
+vm::array *argsort(const vm::array *a, order o);
+
+// Searches the sorted array a as search(T[] a, T key) does.
+Int search(const vm::array *a, const vm::item& key, order o);
+
+// Searches the sorted array a for each element of keys.
+vm::array *searchsorted(const vm::array *a, const vm::array *keys, order o);
+
+// Returns the distinct elements of a in ascending order.
+vm::array *unique(const vm::array *a, order o);
+
+} // namespace sorting
+} // namespace run
+
+#endif
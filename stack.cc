@@ -5,6 +5,7 @@
  * The general stack machine used to run compiled camp code.
  *****/
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -17,6 +18,15 @@
 #include "process.h"
 
 #include "profiler.h"
+#include "sampler.h"
+#include "escape.h"
+
+// Threaded code relies on the labels-as-values extension of GCC (also
+// supported by clang).  The profiler and the stack dump hook into every
+// instruction, so they use the switched interpreter.
+#if defined(__GNUC__) && !defined(PROFILE) && !defined(DEBUG_STACK)
+#define THREADED_DISPATCH
+#endif
 
 #ifdef DEBUG_STACK
 #include <iostream>
@@ -50,6 +60,8 @@ inline stack::vars_t base_frame(
 #endif
   )
 {
+  mem::noteAllocation(mem::FRAMES, size*sizeof(item));
+
   stack::vars_t vars;
 #ifdef SIMPLE_FRAME
   vars = new item[size];
@@ -174,18 +186,12 @@ void dumpProfile() {
 #endif
 
 void assessClosure(lambda *body) {
-  // If we have already determined if it needs closure, just return.
+  // If we have already determined if it needs closure, just return.  This is
+  // normally done by the translator.
   if (body->closureReq != lambda::MAYBE_NEEDS_CLOSURE)
     return;
 
-  for (program::label l = body->code->begin(); l != body->code->end(); ++l)
-    if (l->op == inst::pushclosure ||
-        l->op == inst::pushframe) {
-      body->closureReq = lambda::NEEDS_CLOSURE;
-      return;
-    }
-
-  body->closureReq = lambda::DOESNT_NEED_CLOSURE;
+  assessClosure(body, body->code);
 }
 
 void stack::run(func *f)
@@ -268,74 +274,157 @@ void stack::debug()
 }
 
 
-void stack::runWithOrWithoutClosure(lambda *l, vars_t vars, vars_t parent)
-{
-  // The size of the frame (when running without closure).
-  size_t frameSize = l->parentIndex;
-
 #ifdef SIMPLE_FRAME
-  // Link to the variables, be they in a closure or on the stack.
-  frame *varlink;
-
+#  define VARLINK_T frame *
 #  define SET_VARLINK assert(vars); varlink = vars;
+#  define INIT_VARLINK SET_VARLINK
 #  define VAR(n) ( (varlink)[(n) + frameStart] )
 #  define FRAMEVAR(frame,n) (frame[(n)])
 #else
-  // Link to the variables, be they in a closure or on the stack.
-  mem::vector<item> *varlink=NULL;
-
-#  define SET_VARLINK assert(vars); varlink = &vars->vars
+#  define VARLINK_T mem::vector<item> *
+#  define SET_VARLINK assert(vars); varlink = &vars->vars;
+#  define INIT_VARLINK if (vars) { SET_VARLINK } else varlink = &theStack;
 #  define VAR(n) ( (*varlink)[(n) + frameStart] )
 #  define FRAMEVAR(frame,n) ((*frame)[(n)])
 #endif
 
-  size_t frameStart = 0;
-
-  // Set up the closure, if necessary.
-  if (vars == 0)
-    {
 #ifndef SIMPLE_FRAME
-      assessClosure(l);
-      if (l->closureReq == lambda::NEEDS_CLOSURE)
+// Releases the scoped frames made since it was created.
+struct stack::scopedMark {
+  stack *s;
+  size_t mark;
+
+  scopedMark(stack *s)
+    : s(s), mark(s->scopedUsed) {}
+
+  ~scopedMark() {
+    if (s->scopedUsed > mark)
+      s->releaseScopedFrames(mark);
+  }
+};
+
+void stack::releaseScopedFrames(size_t mark)
+{
+  // Clear the variables, so that they do not keep their values alive.
+  for (size_t i = mark; i < scopedUsed; ++i) {
+    mem::vector<item>& v = scopedFrames[i]->vars;
+    std::fill(v.begin(), v.end(), item());
+  }
+  scopedUsed = mark;
+}
+
+bool stack::madeScopedFrame(size_t mark, vars_t f)
+{
+  for (size_t i = mark; i < scopedUsed; ++i)
+    if (scopedFrames[i] == f)
+      return true;
+  return false;
+}
+
+stack::vars_t stack::makeScopedFrame(lambda *l, vars_t parent)
+{
+  vars_t vars;
+  if (scopedUsed < scopedFrames.size()) {
+    vars = scopedFrames[scopedUsed];
+    vars->vars.resize(l->framesize);
+#ifdef DEBUG_FRAME
+    vars->name = l->name;
+    vars->parentIndex = l->parentIndex;
 #endif
-        {
-          /* make new activation record */
-          vars = vm::make_frame(l, parent);
-          assert(vars);
-        }
+    (*vars)[l->parentIndex] = parent;
+  } else {
+    vars = vm::make_frame(l, parent);
+    scopedFrames.push_back(vars);
+  }
+  ++scopedUsed;
+  return vars;
+}
+#endif
+
+void stack::runWithOrWithoutClosure(lambda *l, vars_t vars, vars_t parent)
+{
 #ifndef SIMPLE_FRAME
-      else
-        {
-          assert(l->closureReq == lambda::DOESNT_NEED_CLOSURE);
+  scopedMark scoped(this);
+#endif
 
-          // Use the stack to store variables.
-          varlink = &theStack;
+  // Functions called in tail position run in turn in this loop, each in
+  // place of its caller, so that tail recursion takes no C++ stack.
+  for (;;) {
+    sampledCall sampled(l);
 
-          // Record where the parameters start on the stack.
-          frameStart = theStack.size() - frameSize;
+    // The size of the frame (when running without closure).
+    size_t frameSize = l->parentIndex;
 
-          // Add the parent's closure to the frame.
-          push(parent);
-          ++frameSize;
+    size_t frameStart = 0;
+
+    // Set up the closure, if necessary.
+    if (vars == 0)
+      {
+#ifndef SIMPLE_FRAME
+        assessClosure(l);
+        if (l->closureReq == lambda::NEEDS_CLOSURE)
+#endif
+          {
+            /* make new activation record */
+            vars = vm::make_frame(l, parent);
+            assert(vars);
+          }
+#ifndef SIMPLE_FRAME
+        else if (l->closureReq == lambda::SCOPED_CLOSURE)
+          vars = makeScopedFrame(l, parent);
+        else
+          {
+            assert(l->closureReq == lambda::DOESNT_NEED_CLOSURE);
 
-          size_t newFrameSize = (size_t)l->framesize;
+            // Use the stack to store variables.
+            // Record where the parameters start on the stack.
+            frameStart = theStack.size() - frameSize;
 
-          if (newFrameSize > frameSize) {
-            theStack.resize(frameStart + newFrameSize);
-            frameSize = newFrameSize;
+            // Add the parent's closure to the frame.
+            push(parent);
+            ++frameSize;
+
+            size_t newFrameSize = (size_t)l->framesize;
+
+            if (newFrameSize > frameSize) {
+              theStack.resize(frameStart + newFrameSize);
+              frameSize = newFrameSize;
+            }
           }
-        }
 #endif
-    }
+      }
 
-  if (vars) {
-    marshall(l->parentIndex, vars);
+    if (vars)
+      marshall(l->parentIndex, vars);
 
-    SET_VARLINK;
+    tailCall next;
+    if (!(settings::threadedcode && bplist.empty() && settings::verbose <= 4 ?
+          runThreaded(l, vars, frameStart, frameSize, next) :
+          runSwitched(l, vars, frameStart, frameSize, 0, next)))
+      return;
+
+#ifndef SIMPLE_FRAME
+    // The scoped frames of the callers replaced so far are no longer used,
+    // unless the function called closes over one of them.
+    if (!madeScopedFrame(scoped.mark, next.closure))
+      releaseScopedFrames(scoped.mark);
+#endif
+
+    l = next.body;
+    parent = next.closure;
+    vars = 0;
   }
+}
+
+bool stack::runSwitched(lambda *l, vars_t vars, size_t frameStart,
+                        size_t frameSize, size_t start, tailCall& next)
+{
+  // Link to the variables, be they in a closure or on the stack.
+  VARLINK_T varlink;
+  INIT_VARLINK;
 
   /* start the new function */
-  program::label ip = l->code->begin();
+  program::label ip = l->code->at(start);
   processDataStruct& P=processData();
   position& topPos=P.topPos;
   string& fileName=P.fileName;
@@ -369,6 +458,7 @@ void stack::runWithOrWithoutClosure(lambda *l, vars_t vars, vars_t parent)
       switch (i.op)
         {
           case inst::varpush:
+          case inst::varpush_builtin:
             push(VAR(get<Int>(i)));
             break;
 
@@ -376,11 +466,16 @@ void stack::runWithOrWithoutClosure(lambda *l, vars_t vars, vars_t parent)
             VAR(get<Int>(i)) = top();
             break;
 
-#ifdef COMBO
           case inst::varpop:
             VAR(get<Int>(i)) = pop();
             break;
-#endif
+
+          case inst::varpush2: {
+            Int n = get<Int>(i);
+            push(VAR(firstOperand(n)));
+            push(VAR(secondOperand(n)));
+            break;
+          }
 
           case inst::ret: {
             if (vars == 0)
@@ -388,7 +483,7 @@ void stack::runWithOrWithoutClosure(lambda *l, vars_t vars, vars_t parent)
               // TODO: Optimize for common cases.
               theStack.erase(theStack.begin() + frameStart,
                              theStack.begin() + frameStart + frameSize);
-            return;
+            return false;
           }
 
           case inst::pushframe:
@@ -445,24 +540,44 @@ void stack::runWithOrWithoutClosure(lambda *l, vars_t vars, vars_t parent)
             break;
           }
 
-#if COMBO
           case inst::fieldpop: {
-#error NOT REIMPLEMENTED
             vars_t frame = pop<vars_t>();
             if (!frame)
               error(dereferenceNullPointer);
-            FRAMEVAR(get<Int>(i)) = pop();
+            FRAMEVAR(frame, get<Int>(i)) = pop();
             break;
           }
-#endif
 
+          case inst::varfieldpush: {
+            Int n = get<Int>(i);
+            vars_t frame = get<vars_t>(VAR(firstOperand(n)));
+            if (!frame)
+              error(dereferenceNullPointer);
+            push(FRAMEVAR(frame, secondOperand(n)));
+            break;
+          }
+
+          case inst::fieldpush2: {
+            Int n = get<Int>(i);
+            vars_t frame = pop<vars_t>();
+            if (!frame)
+              error(dereferenceNullPointer);
+            frame = get<vars_t>(FRAMEVAR(frame, firstOperand(n)));
+            if (!frame)
+              error(dereferenceNullPointer);
+            push(FRAMEVAR(frame, secondOperand(n)));
+            break;
+          }
 
           case inst::builtin: {
             bltin func = get<bltin>(i);
 #ifdef PROFILE
             prof.beginFunction(func);
 #endif
-            func(this);
+            {
+              sampledBuiltin sampled(func);
+              func(this);
+            }
 #ifdef PROFILE
             prof.endFunction(func);
 #endif
@@ -485,33 +600,19 @@ void stack::runWithOrWithoutClosure(lambda *l, vars_t vars, vars_t parent)
             if (!isdefault(pop())) { ip = get<program::label>(i); continue; }
             break;
 
-#ifdef COMBO
-          case inst::gejmp: {
-            Int y = pop<Int>();
-            Int x = pop<Int>();
-            if (x>=y)
-              { ip = get<program::label>(i); continue; }
-            break;
-          }
-
-#if 0
-          case inst::jump_if_func_eq: {
-            callable * b=pop<callable *>();
-            callable * a=pop<callable *>();
-            if (a->compare(b))
-              { ip = get<program::label>(i); continue; }
-            break;
+#define INTJMP(name, cmp)                                       \
+          case inst::name: {                                    \
+            Int y = pop<Int>();                                 \
+            Int x = pop<Int>();                                 \
+            if (x cmp y) { ip = get<program::label>(i); continue; } \
+            break;                                              \
           }
 
-          case inst::jump_if_func_neq: {
-            callable * b=pop<callable *>();
-            callable * a=pop<callable *>();
-            if (!a->compare(b))
-              { ip = get<program::label>(i); continue; }
-            break;
-          }
-#endif
-#endif
+          INTJMP(ltjmp, <)
+          INTJMP(lejmp, <=)
+          INTJMP(gejmp, >=)
+          INTJMP(gtjmp, >)
+#undef INTJMP
 
           case inst::push_default:
             push(Default);
@@ -524,6 +625,22 @@ void stack::runWithOrWithoutClosure(lambda *l, vars_t vars, vars_t parent)
             break;
           }
 
+          case inst::tailcall: {
+            callable* f = pop<callable*>();
+            if (func *g = dynamic_cast<func *>(f)) {
+              // Only the arguments of g are left above the frame.
+              if (vars == 0)
+                theStack.erase(theStack.begin() + frameStart,
+                               theStack.begin() + frameStart + frameSize);
+              next.body = g->body;
+              next.closure = g->closure;
+              return true;
+            }
+            // Other callables run as usual, followed by the return.
+            f->call(this);
+            break;
+          }
+
           case inst::makefunc: {
             func *f = new func;
             f->closure = pop<vars_t>();
@@ -548,11 +665,471 @@ void stack::runWithOrWithoutClosure(lambda *l, vars_t vars, vars_t parent)
   } catch (bad_item_value&) {
     error("Trying to use uninitialized value.");
   }
+  return false;
+}
+
+#ifdef THREADED_DISPATCH
+
+// A monomorphic inline cache for a call: the callable last called there and
+// what it runs, so that calling it again skips the virtual dispatch.
+struct callCache : public gc {
+  callable *f;
+  // The function it runs, if it is a func,
+  lambda *body;
+  frame *closure;
+  // or the builtin, if it is a bfunc.
+  bltin b;
+
+  callCache() : f(0), body(0), closure(0), b(0) {}
+
+  void fill(callable *g) {
+    f = g;
+    body = 0;
+    closure = 0;
+    b = 0;
+    if (func *h = dynamic_cast<func *>(g)) {
+      body = h->body;
+      closure = h->closure;
+    } else if (bfunc *h = dynamic_cast<bfunc *>(g))
+      b = h->getBuiltin();
+  }
+};
+
+// An instruction decoded for the threaded interpreter: the address of the
+// code implementing its opcode, its operand in unboxed form, and the original
+// instruction, which is consulted only for positions.
+struct threadedInst {
+  const void *handler;
+  union {
+    Int n;
+    bltin b;
+    lambda *l;
+    const item *ref;
+    threadedInst *target;
+    callCache *cache;
+  };
+  const inst *source;
+};
+
+struct threadedCode : public gc {
+  // The number of instructions in the program when it was decoded.
+  size_t size;
+  // The decoded instructions, followed by a sentinel.
+  mem::vector<threadedInst> code;
+};
+
+namespace {
+// The index of a jump in the table of backward-branching handlers.
+size_t backIndex(inst::opcode op)
+{
+  switch (op) {
+    case inst::jmp: return 0;
+    case inst::cjmp: return 1;
+    case inst::njmp: return 2;
+    case inst::jump_if_not_default: return 3;
+    case inst::ltjmp: return 4;
+    case inst::lejmp: return 5;
+    case inst::gejmp: return 6;
+    case inst::gtjmp: return 7;
+    default:
+      assert(0);
+      return 0;
+  }
+}
+
+threadedCode *decode(program *code, const void *const *handlers,
+                     const void *const *backHandlers, const void *bad)
+{
+  threadedCode *t=new threadedCode;
+  size_t n=offset(code->begin(), code->end());
+  t->size=n;
+  t->code.resize(n+1);
+
+  size_t k=0;
+  for (program::label ip = code->begin(); ip != code->end(); ++ip, ++k) {
+    const inst& i = *ip;
+    threadedInst& d = t->code[k];
+    d.source = &i;
+    d.handler = handlers[i.op];
+    switch (i.op) {
+      case inst::varpush:
+      case inst::varsave:
+      case inst::fieldpush:
+      case inst::fieldsave:
+      case inst::pushframe:
+      case inst::varpop:
+      case inst::fieldpop:
+      case inst::varpush2:
+      case inst::varfieldpush:
+      case inst::fieldpush2:
+      case inst::varpush_builtin:
+        d.n = get<Int>(i);
+        break;
+
+      case inst::intpush:
+      case inst::constpush:
+        d.ref = &i.ref;
+        break;
+
+      case inst::builtin:
+        d.b = get<bltin>(i);
+        break;
+
+      case inst::makefunc:
+        d.l = get<lambda*>(i);
+        break;
+
+      case inst::popcall:
+      case inst::tailcall:
+        d.cache = new callCache;
+        break;
+
+      case inst::jmp:
+      case inst::cjmp:
+      case inst::njmp:
+      case inst::jump_if_not_default:
+      case inst::ltjmp:
+      case inst::lejmp:
+      case inst::gejmp:
+      case inst::gtjmp:
+      {
+        size_t where = offset(code->begin(), get<program::label>(i));
+        assert(where <= n);
+        d.target = &t->code[where];
+        // Backward branches close loops, so they poll for interrupts.
+        if (where <= k)
+          d.handler = backHandlers[backIndex(i.op)];
+        break;
+      }
+
+      default:
+        d.n = 0;
+        break;
+    }
+  }
+
+  threadedInst& end = t->code[n];
+  end.handler = bad;
+  end.n = 0;
+  end.source = n > 0 ? t->code[n-1].source : 0;
+
+  return t;
+}
+}
+
+bool stack::runThreaded(lambda *l, vars_t vars, size_t frameStart,
+                        size_t frameSize, tailCall& next)
+{
+  static const void *const handlers[] = {
+#define OPCODE(name, type) &&L_##name,
+#include "opcodes.h"
+#undef OPCODE
+  };
+
+  // Variants of the jumps for branching backward.
+  static const void *const backHandlers[] = {
+    &&B_jmp, &&B_cjmp, &&B_njmp, &&B_jump_if_not_default,
+    &&B_ltjmp, &&B_lejmp, &&B_gejmp, &&B_gtjmp
+  };
+
+  threadedCode *code = l->threaded;
+  if (!code || code->size != (size_t) offset(l->code->begin(), l->code->end()))
+    code = l->threaded = decode(l->code, handlers, backHandlers, &&L_bad);
+
+  VARLINK_T varlink;
+  INIT_VARLINK;
+
+  processDataStruct& P=processData();
+  position& topPos=P.topPos;
+  string& fileName=P.fileName;
+  unsigned int offset=P.xmapCount;
+
+  threadedInst *begin = &code->code[0];
+  threadedInst *t = begin;
+
+  // The per-instruction bookkeeping of the switched loop is done only where
+  // it can be observed: positions are recorded before calls (so builtins and
+  // error messages see them) and interrupts, breakpoints, and tracing are
+  // checked at calls and backward branches.  If the debugger or tracing has
+  // been switched on, the rest of the function runs in the switched loop.
+#define SETPOS                                                  \
+  curPos = t->source->pos;                                      \
+  if (curPos.match(fileName))                                   \
+    topPos=curPos.shift(offset)
+
+#define POLL                                                    \
+  if (errorstream::interrupt) throw interrupted();              \
+  if (!bplist.empty() || settings::verbose > 4) {               \
+    return runSwitched(l, vars, frameStart, frameSize, t - begin, \
+                       next);                                   \
+  }
+
+#define NEXT goto *(++t)->handler
+#define JUMP t = t->target; goto *t->handler
+#define BACKJUMP SETPOS; POLL; JUMP
+
+  try {
+    SETPOS;
+    goto *t->handler;
+
+  L_varpush:
+    push(VAR(t->n));
+    NEXT;
+
+  L_varsave:
+    VAR(t->n) = top();
+    NEXT;
+
+  L_ret:
+    if (vars == 0)
+      // Delete the frame from the stack.
+      theStack.erase(theStack.begin() + frameStart,
+                     theStack.begin() + frameStart + frameSize);
+    return false;
+
+  L_pushframe:
+    assert(vars);
+    vars=make_pushframe(t->n, vars);
+    SET_VARLINK;
+    NEXT;
+
+  L_popframe:
+    assert(vars);
+    vars=get<frame *>(VAR(0));
+    SET_VARLINK;
+    NEXT;
+
+  L_pushclosure:
+    assert(vars);
+    push(vars);
+    NEXT;
+
+  L_nop:
+    NEXT;
+
+  L_pop:
+    pop();
+    NEXT;
+
+  L_intpush:
+  L_constpush:
+    push(*t->ref);
+    NEXT;
+
+  L_fieldpush: {
+    vars_t frame = pop<vars_t>();
+    if (!frame) {
+      curPos = t->source->pos;
+      error(dereferenceNullPointer);
+    }
+    push(FRAMEVAR(frame, t->n));
+    NEXT;
+  }
+
+  L_fieldsave: {
+    vars_t frame = pop<vars_t>();
+    if (!frame) {
+      curPos = t->source->pos;
+      error(dereferenceNullPointer);
+    }
+    FRAMEVAR(frame, t->n) = top();
+    NEXT;
+  }
+
+  L_builtin:
+    SETPOS;
+    POLL;
+    {
+      sampledBuiltin sampled(t->b);
+      t->b(this);
+    }
+    NEXT;
+
+  L_jmp:
+    JUMP;
+
+  L_cjmp:
+    if (pop<bool>()) { JUMP; }
+    NEXT;
+
+  L_njmp:
+    if (!pop<bool>()) { JUMP; }
+    NEXT;
+
+  L_jump_if_not_default:
+    if (!isdefault(pop())) { JUMP; }
+    NEXT;
+
+  B_jmp:
+    BACKJUMP;
+
+  B_cjmp:
+    if (pop<bool>()) { BACKJUMP; }
+    NEXT;
+
+  B_njmp:
+    if (!pop<bool>()) { BACKJUMP; }
+    NEXT;
+
+  B_jump_if_not_default:
+    if (!isdefault(pop())) { BACKJUMP; }
+    NEXT;
+
+  L_varpop:
+    VAR(t->n) = pop();
+    NEXT;
+
+  L_fieldpop: {
+    vars_t frame = pop<vars_t>();
+    if (!frame) {
+      curPos = t->source->pos;
+      error(dereferenceNullPointer);
+    }
+    FRAMEVAR(frame, t->n) = pop();
+    NEXT;
+  }
+
+  L_varpush2:
+    push(VAR(firstOperand(t->n)));
+    push(VAR(secondOperand(t->n)));
+    NEXT;
+
+  L_varfieldpush: {
+    vars_t frame = get<vars_t>(VAR(firstOperand(t->n)));
+    if (!frame) {
+      curPos = t->source->pos;
+      error(dereferenceNullPointer);
+    }
+    push(FRAMEVAR(frame, secondOperand(t->n)));
+    NEXT;
+  }
+
+  L_fieldpush2: {
+    vars_t frame = pop<vars_t>();
+    if (frame)
+      frame = get<vars_t>(FRAMEVAR(frame, firstOperand(t->n)));
+    if (!frame) {
+      curPos = t->source->pos;
+      error(dereferenceNullPointer);
+    }
+    push(FRAMEVAR(frame, secondOperand(t->n)));
+    NEXT;
+  }
+
+  // The builtin that follows is entered directly, without a dispatch.
+  L_varpush_builtin:
+    push(VAR(t->n));
+    ++t;
+    goto L_builtin;
+
+#define INTJMP(name, cmp)                       \
+  L_##name: {                                   \
+    Int y = pop<Int>();                         \
+    Int x = pop<Int>();                         \
+    if (x cmp y) { JUMP; }                      \
+    NEXT;                                       \
+  }                                             \
+  B_##name: {                                   \
+    Int y = pop<Int>();                         \
+    Int x = pop<Int>();                         \
+    if (x cmp y) { BACKJUMP; }                  \
+    NEXT;                                       \
+  }
+
+  INTJMP(ltjmp, <)
+  INTJMP(lejmp, <=)
+  INTJMP(gejmp, >=)
+  INTJMP(gtjmp, >)
+#undef INTJMP
+
+  L_push_default:
+    push(Default);
+    NEXT;
+
+  L_popcall: {
+    SETPOS;
+    POLL;
+    /* get the function reference off of the stack */
+    callable* f = pop<callable*>();
+    callCache *c = t->cache;
+    if (f != c->f)
+      c->fill(f);
+    if (c->body)
+      runWithOrWithoutClosure(c->body, 0, c->closure);
+    else if (c->b) {
+      sampledBuiltin sampled(c->b);
+      c->b(this);
+    } else
+      f->call(this);
+    NEXT;
+  }
+
+  L_tailcall: {
+    SETPOS;
+    POLL;
+    callable* f = pop<callable*>();
+    callCache *c = t->cache;
+    if (f != c->f)
+      c->fill(f);
+    if (c->body) {
+      // Only the arguments of the function are left above the frame.
+      if (vars == 0)
+        theStack.erase(theStack.begin() + frameStart,
+                       theStack.begin() + frameStart + frameSize);
+      next.body = c->body;
+      next.closure = c->closure;
+      return true;
+    }
+    // Other callables run as usual, followed by the return.
+    if (c->b) {
+      sampledBuiltin sampled(c->b);
+      c->b(this);
+    } else
+      f->call(this);
+    NEXT;
+  }
+
+  L_makefunc: {
+    func *f = new func;
+    f->closure = pop<vars_t>();
+    f->body = t->l;
+
+    push((callable*)f);
+    NEXT;
+  }
+
+  L_bad:
+    curPos = t->source ? t->source->pos : nullPos;
+    error("Internal VM error: Bad stack operand");
+
+  } catch (bad_item_value&) {
+    curPos = t->source->pos;
+    error("Trying to use uninitialized value.");
+  }
+  return false;
+
+#undef SETPOS
+#undef POLL
+#undef NEXT
+#undef JUMP
+#undef BACKJUMP
+}
 
+#else
+
+bool stack::runThreaded(lambda *l, vars_t vars, size_t frameStart,
+                        size_t frameSize, tailCall& next)
+{
+  return runSwitched(l, vars, frameStart, frameSize, 0, next);
+}
+
+#endif
+
+#undef VARLINK_T
 #undef SET_VARLINK
+#undef INIT_VARLINK
 #undef VAR
 #undef FRAMEVAR
-}
 
 void stack::load(string index) {
   frame *inst=instMap[index];
@@ -78,9 +78,39 @@ private:
   // Move arguments from stack to frame.
   void marshall(size_t args, stack::vars_t vars);
 
+  // The frames of functions with scoped closures.  Such a frame cannot
+  // outlive the call it was made for, so it is reused once the call returns.
+  mem::vector<frame *> scopedFrames;
+  size_t scopedUsed;
+
+  struct scopedMark;
+  vars_t makeScopedFrame(lambda *l, vars_t parent);
+  void releaseScopedFrames(size_t mark);
+
+  // A function to run in place of the one that called it in tail position.
+  struct tailCall {
+    lambda *body;
+    vars_t closure;
+  };
+
+  // Returns true if one of the scoped frames made since mark is f.
+  bool madeScopedFrame(size_t mark, vars_t f);
+
+  // Interpret the code of l, starting at instruction number start, once its
+  // activation record has been set up by runWithOrWithoutClosure.  The
+  // switched loop supports the debugger and tracing; the threaded loop, when
+  // compiled in, is the fast path and hands control to the switched loop
+  // whenever those are enabled.  If the code ends with a tail call of a
+  // function, the frame of l is taken off the stack and the loops return true,
+  // leaving the function to be run in next.
+  bool runSwitched(lambda *l, vars_t vars, size_t frameStart,
+                   size_t frameSize, size_t start, tailCall& next);
+  bool runThreaded(lambda *l, vars_t vars, size_t frameStart,
+                   size_t frameSize, tailCall& next);
+
 public:
   stack() : e(0), debugOp(0), lastPos(nullPos),
-            breakPos(nullPos), newline(false) {};
+            breakPos(nullPos), newline(false), scopedUsed(0) {};
 
   virtual ~stack() {};
 
@@ -193,6 +193,20 @@ void ifStm::prettyprint(ostream &out, Int indent)
     onFalse->prettyprint(out, indent+1);
 }
 
+// Translates a branch of an if statement.  A constant test leaves one of the
+// branches unreachable; it is still translated, so that its errors are
+// reported, but its code is dropped.
+void transBranch(coenv &e, stm *branch)
+{
+  bool reachable = e.c.fallsThrough();
+  size_t start = e.c.mark();
+
+  branch->markTrans(e);
+
+  if (!reachable)
+    e.c.discardSince(start);
+}
+
 void ifStm::trans(coenv &e)
 {
   label elseLabel = e.c.fwdLabel();
@@ -200,14 +214,16 @@ void ifStm::trans(coenv &e)
 
   test->transConditionalJump(e, false, elseLabel);
 
-  onTrue->markTrans(e);
+  transBranch(e, onTrue);
 
   if (onFalse) {
     // Encode the jump around the 'else' clause at the end of the 'if' clause
-    e.c.useLabel(inst::jmp,end);
+    if (e.c.fallsThrough())
+      e.c.useLabel(inst::jmp,end);
 
-    e.c.defLabel(elseLabel);
-    onFalse->markTrans(e);
+    if (elseLabel->used())
+      e.c.defLabel(elseLabel);
+    transBranch(e, onFalse);
   } else {
     e.c.defLabel(elseLabel);
   }
@@ -245,10 +261,12 @@ void transLoopBody(coenv &e, stm *body) {
   //
   // will write 50.  This is implemented by allocating a new frame for each
   // iteration.  However, this can have a big performance hit, so we first
-  // translate the code without the frame, check if it needed the closure, and
-  // rewrite the code if necessary.
+  // translate the code without the frame, check if the closure could outlive
+  // the iteration, and rewrite the code if necessary.  Functions defined in
+  // the body and only called there do not need the frame.
 
   label start = e.c.defNewLabel();
+  Int firstLocal = e.c.getFrame()->size();
 
   // Encode a no-op, in case we need to jump over the default implementation
   // to a special case.
@@ -260,7 +278,7 @@ void transLoopBody(coenv &e, stm *body) {
   if (em.errors())
     return;
 
-  if (e.c.usesClosureSinceLabel(start)){
+  if (e.c.closureEscapesSinceLabel(start, firstLocal)){
     // Jump over the old section.
     label end = e.c.defNewLabel();
     e.c.encodePatch(start, end);
@@ -0,0 +1,43 @@
+/*****
+ * stringbuilder.h
+ *
+ * A mutable string, appended to in amortized constant time.
+ *****/
+
+#ifndef STRINGBUILDER_H
+#define STRINGBUILDER_H
+
+#include "common.h"
+
+namespace camp {
+
+class stringbuilder : public gc {
+  string buf;
+public:
+  stringbuilder() {}
+
+  void append(const string& s) {
+    buf.append(s);
+  }
+
+  void reserve(size_t n) {
+    buf.reserve(n);
+  }
+
+  void clear() {
+    buf.clear();
+  }
+
+  size_t size() const {
+    return buf.size();
+  }
+
+  // The contents, for writing without a copy.
+  const string& str() const {
+    return buf;
+  }
+};
+
+} // namespace camp
+
+#endif
@@ -13,6 +13,8 @@
 #include <cassert>
 
 #include "common.h"
+#include "gcstats.h"
+#include "gcpolicy.h"
 
 using std::ostream;
 
@@ -26,6 +28,7 @@ struct GCInit {
 #endif
   GCInit() {
 #ifdef USEGC
+    mem::preinitGCPolicy();
     GC_set_free_space_divisor(2);
     mem::compact(0);
     GC_INIT();
@@ -33,6 +36,7 @@ struct GCInit {
     GC_allow_register_threads();
 #endif
 #endif
+    mem::startGCStats();
 
     // Put the symbol table into a state where symbols can be translated.
     initTable();
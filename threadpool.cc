@@ -0,0 +1,124 @@
+/*****
+ * threadpool.cc
+ *
+ * The pool of threads that runs parallel loops.
+ *****/
+
+#include <condition_variable>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include <unistd.h>
+
+#include "common.h"
+#include "threadpool.h"
+#include "sampler.h"
+
+namespace camp {
+
+namespace {
+
+class pool {
+  std::mutex lock;
+  std::condition_variable wake,finished;
+
+  // The job of the current loop, the number of threads that may still join
+  // it, and the number running it.  Each loop has a new generation.
+  const std::function<void()> *job;
+  size_t wanted;
+  size_t running;
+  size_t generation;
+
+  void serve() {
+#if defined(USEGC) && defined(HAVE_PTHREAD)
+    GC_stack_base base;
+    GC_get_stack_base(&base);
+    GC_register_my_thread(&base);
+#endif
+    vm::blockSampling();
+    size_t seen=0;
+    std::unique_lock<std::mutex> l(lock);
+    for(;;) {
+      wake.wait(l,[&] {return generation != seen;});
+      seen=generation;
+      if(wanted == 0) continue;
+      --wanted;
+      ++running;
+      l.unlock();
+      (*job)();
+      l.lock();
+      if(--running == 0)
+        finished.notify_one();
+    }
+  }
+
+public:
+  size_t size;
+
+  pool() : job(0), wanted(0), running(0), generation(0), size(0) {
+    size_t n=std::thread::hardware_concurrency();
+    for(; size+1 < n; ++size) {
+      try {
+        std::thread(&pool::serve,this).detach();
+      } catch(std::system_error&) {
+        break;
+      }
+    }
+  }
+
+  void run(const std::function<void()>& f, size_t n) {
+    {
+      std::lock_guard<std::mutex> l(lock);
+      job=&f;
+      wanted=std::min(n-1,size);
+      ++generation;
+    }
+    wake.notify_all();
+    f();
+
+    // Threads that have not yet joined would find nothing left to do.
+    std::unique_lock<std::mutex> l(lock);
+    wanted=0;
+    finished.wait(l,[this] {return running == 0;});
+    job=0;
+  }
+};
+
+std::atomic<bool> busy(false);
+
+// The pool is never destroyed, as its threads never finish.  A child forked
+// from a process with a pool has none of its threads, so starts its own.
+pool& instance()
+{
+  static pool *p=0;
+  static pid_t owner=0;
+  if(!p || owner != getpid()) {
+    p=new pool;
+    owner=getpid();
+  }
+  return *p;
+}
+
+} // namespace
+
+size_t parallelThreads()
+{
+  return std::max(std::thread::hardware_concurrency(),1u);
+}
+
+bool runInPool(const std::function<void()>& job, size_t n)
+{
+  if(busy.exchange(true))
+    return false;
+  try {
+    instance().run(job,n);
+  } catch(...) {
+    busy=false;
+    throw;
+  }
+  busy=false;
+  return true;
+}
+
+} // namespace camp
@@ -0,0 +1,57 @@
+/*****
+ * threadpool.h
+ *
+ * Loops whose iterations are run by a pool of threads registered with the
+ * garbage collector, which are started once and reused by every loop.
+ *****/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+
+namespace camp {
+
+// The number of threads, including the caller, that may run a loop.
+size_t parallelThreads();
+
+// Runs job in the calling thread and in up to n-1 threads of the pool,
+// returning once every call has returned.  Returns false without running
+// job if the pool is running another loop, as when called from within one.
+bool runInPool(const std::function<void()>& job, size_t n);
+
+// Calls f(k) for each k < n, in parallel unless another loop is running, so
+// that a loop nested in another runs in the thread that reaches it.  The
+// first exception thrown by f is rethrown once every call has finished.
+template<class F>
+void parallelFor(size_t n, F f)
+{
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::exception_ptr error;
+  auto work=[&] {
+    try {
+      for(size_t k; !failed && (k=next++) < n;)
+        f(k);
+    } catch(...) {
+      if(!failed.exchange(true))
+        error=std::current_exception();
+    }
+  };
+
+  size_t threads=std::min(parallelThreads(),n);
+  if(threads <= 1 || !runInPool(work,threads)) {
+    for(size_t k=0; k < n; ++k)
+      f(k);
+    return;
+  }
+  if(error)
+    std::rethrow_exception(error);
+}
+
+} // namespace camp
+
+#endif
@@ -36,7 +36,7 @@ void multiplyTransform3(double*& t, const double* s, const double* r);
 void boundstriples(double& x, double& y, double& z, double& X, double& Y,
                    double& Z, size_t n, const triple* v);
 
-class triple : virtual public gc {
+class triple : public gc {
   double x;
   double y;
   double z;
@@ -46,8 +46,6 @@ public:
   triple(double x, double y=0.0, double z=0.0) : x(x), y(y), z(z) {}
   triple(const Triple& v) : x(v[0]), y(v[1]), z(v[2]) {}
 
-  virtual ~triple() {}
-
   void set(double X, double Y=0.0, double Z=0.0) { x=X; y=Y; z=Z; }
 
   double getx() const { return x; }
@@ -16,6 +16,9 @@
 #include "runfile.h"
 #include "runpair.h"
 #include "runtriple.h"
+#include "runmap.h"
+#include "hashmap.h"
+#include "callable.h"
 #include "access.h"
 #include "virtualfieldaccess.h"
 
@@ -58,7 +61,8 @@ const char *names[] = {
 #undef PRIMERROR
 #undef PRIMITIVE
 
-  "<array>"
+  "<array>",
+  "<map>"
 };
 
 ty::~ty()
@@ -105,6 +109,14 @@ void ty::print(ostream& out) const
       return v;                                                         \
     }
 
+// A field whose type depends on the type of the object, such as the keys
+// of a map.
+#define DFIELD(name, sym, func)                                 \
+  if (sig == 0 && id == sym) {                                  \
+    static trans::virtualFieldAccess a(run::func);              \
+    return new trans::varEntry(name##Type(), &a, 0, position()); \
+  }
+
 #define FILEFIELD(GetType, SetType, name, sym)  \
   FIELD(GetType,sym,name##Part);                \
   SIGFIELD(SetType,sym,name##Set);
@@ -229,6 +241,9 @@ trans::access *nullTy::castTo(ty *target, caster &) {
     case ty_function: {
       RETURN_STATIC_BLTIN(pushNullFunction);
     }
+    case ty_map: {
+      RETURN_STATIC_BLTIN(pushNullMap);
+    }
     default:
       return 0;
   }
@@ -236,8 +251,11 @@ trans::access *nullTy::castTo(ty *target, caster &) {
 
 trans::access *array::initializer()
 {
-  RETURN_STATIC_BLTIN(emptyArray)
-    }
+  if (packed())
+    RETURN_STATIC_BLTIN(emptyPackedArray)
+  else
+    RETURN_STATIC_BLTIN(emptyArray)
+}
 
 ty *array::pushType()
 {
@@ -326,6 +344,90 @@ trans::varEntry *array::virtualField(symbol id, signature *sig)
 
 #undef SIGFIELDLIST
 
+ty *map::keysType()
+{
+  if (keystype == 0)
+    keystype = new array(key);
+
+  return keystype;
+}
+
+ty *map::valuesType()
+{
+  if (valuestype == 0)
+    valuestype = new array(value);
+
+  return valuestype;
+}
+
+ty *map::initializedType()
+{
+  if (initializedtype == 0)
+    initializedtype = new function(primBoolean(),formal(key,SYM(key)));
+
+  return initializedtype;
+}
+
+ty *map::deleteType()
+{
+  if (deletetype == 0)
+    deletetype = new function(primVoid(),formal(key,SYM(key)));
+
+  return deletetype;
+}
+
+trans::access *map::initializer()
+{
+  vm::hashmap::keyKind k;
+  switch (key->kind) {
+    case ty_Int: k = vm::hashmap::INT; break;
+    case ty_real: k = vm::hashmap::REAL; break;
+    case ty_string: k = vm::hashmap::STRING; break;
+    case ty_pair: k = vm::hashmap::PAIR; break;
+    default: k = vm::hashmap::TRIPLE; break;
+  }
+
+  // The runtime needs the kind of key, to hash it, and the placement of the
+  // values.
+  Int code = 2 * (Int) k + (array::packedCell(value) ? 1 : 0);
+  return new trans::callableAccess(
+    new vm::thunk(new vm::bfunc(run::emptyMap), code));
+}
+
+#define SIGFIELDLIST                                            \
+  ASIGFIELD(initialized, SYM(initialized), mapInitialized);     \
+  ASIGFIELD(delete, SYM(delete), mapDelete);                    \
+
+ty *map::virtualFieldGetType(symbol id)
+{
+#define ASIGFIELD(name, sym, func)              \
+  if (id == sym)                                \
+    return name##Type();
+
+  SIGFIELDLIST
+
+#undef ASIGFIELD
+
+    return ty::virtualFieldGetType(id);
+}
+
+trans::varEntry *map::virtualField(symbol id, signature *sig)
+{
+  FIELD(primInt, SYM(length), mapLength);
+  DFIELD(keys, SYM(keys), mapKeys);
+  DFIELD(values, SYM(values), mapValues);
+
+#define ASIGFIELD(name, sym, func) DSIGFIELD(name, sym, func)
+
+  SIGFIELDLIST
+
+#undef ASIGFIELD
+
+    return ty::virtualField(id, sig);
+}
+
+#undef SIGFIELDLIST
+
 void printFormal(ostream& out, const formal& f, bool keywordOnly)
 {
   if (f.Explicit)
@@ -552,5 +654,6 @@ bool equivalent(const ty *t1, const ty *t2, bool special) {
 #undef RWFIELD
 #undef SIGFIELD
 #undef DSIGFIELD
+#undef DFIELD
 
 } // namespace types
@@ -47,7 +47,8 @@ enum ty_kind {
 #undef PRIMERROR
 #undef PRIMITIVE
 
-  ty_array
+  ty_array,
+  ty_map
 };
 
 // Forward declarations.
@@ -253,6 +254,17 @@ struct array : public ty {
     return 1007 * celltype->hash();
   }
 
+  // Arrays of reals, integers, and booleans are packed into pointer-free
+  // storage.
+  static bool packedCell(const ty *celltype) {
+    return celltype->kind == ty_real || celltype->kind == ty_Int ||
+      celltype->kind == ty_boolean;
+  }
+
+  bool packed() const {
+    return packedCell(celltype);
+  }
+
   Int depth() {
     if (array *cell=dynamic_cast<array *>(celltype))
       return cell->depth() + 1;
@@ -279,6 +291,55 @@ struct array : public ty {
   trans::varEntry *virtualField(symbol id, signature *sig);
 };
 
+// A map from keys of type int, real, string, pair, or triple to values.
+struct map : public ty {
+  ty *key;
+  ty *value;
+  ty *keystype;
+  ty *valuestype;
+  ty *initializedtype;
+  ty *deletetype;
+
+  map(ty *key, ty *value)
+    : ty(ty_map), key(key), value(value), keystype(0), valuestype(0),
+      initializedtype(0), deletetype(0) {}
+
+  virtual bool isReference() {
+    return true;
+  }
+
+  bool equiv(const ty *other) const {
+    return other->kind==ty_map &&
+      equivalent(this->key,((map *)other)->key) &&
+      equivalent(this->value,((map *)other)->value);
+  }
+
+  size_t hash() const {
+    return 1009 * key->hash() + value->hash();
+  }
+
+  // Whether t may be the type of the keys of a map.
+  static bool keyType(const ty *t) {
+    return t->kind == ty_Int || t->kind == ty_real || t->kind == ty_string ||
+      t->kind == ty_pair || t->kind == ty_triple;
+  }
+
+  void print(ostream& out) const
+  { out << *value << "[" << *key << "]"; }
+
+  ty *keysType();
+  ty *valuesType();
+  ty *initializedType();
+  ty *deleteType();
+
+  // Initialize to an empty map by default.
+  trans::access *initializer();
+
+  // Add length, keys, values, initialized, and delete as virtual fields.
+  ty *virtualFieldGetType(symbol id);
+  trans::varEntry *virtualField(symbol id, signature *sig);
+};
+
 /* Base types */
 #define PRIMITIVE(name,Name,asyName)            \
   ty *prim##Name();                             \
@@ -48,16 +48,18 @@ void arrayinit::prettyprint(ostream &out, Int indent)
     rest->prettyprint(out, indent+1);
 }
 
-void arrayinit::transMaker(coenv &e, Int size, bool rest) {
+void arrayinit::transMaker(coenv &e, Int size, bool rest, bool packed) {
   // Push the number of cells and call the array maker.
   e.c.encode(inst::intpush, size);
   e.c.encode(inst::builtin, rest ? run::newAppendedArray :
+             packed ? run::newInitializedPackedArray :
              run::newInitializedArray);
 }
 
 void arrayinit::transToType(coenv &e, types::ty *target)
 {
   types::ty *celltype;
+  bool packed=false;
   if (target->kind != types::ty_array) {
     em.error(getPos());
     em << "array initializer used for non-array";
@@ -65,6 +67,7 @@ void arrayinit::transToType(coenv &e, types::ty *target)
   }
   else {
     celltype = ((types::array *)target)->celltype;
+    packed = ((types::array *)target)->packed();
   }
 
   // Push the values on the stack.
@@ -74,7 +77,7 @@ void arrayinit::transToType(coenv &e, types::ty *target)
   if (rest)
     rest->transToType(e, target);
 
-  transMaker(e, (Int)inits.size(), (bool)rest);
+  transMaker(e, (Int)inits.size(), (bool)rest, packed);
 }
 
 } // namespace absyntax
@@ -67,7 +67,8 @@ public:
   void prettyprint(ostream &out, Int indent);
 
   // Encodes the instructions to make an array from size elements on the stack.
-  static void transMaker(coenv &e, Int size, bool rest);
+  // The array is packed if its cells are reals, integers, or booleans.
+  static void transMaker(coenv &e, Int size, bool rest, bool packed=false);
 
   void transToType(coenv &e, types::ty *target);
 
@@ -39,7 +39,7 @@ public:
   virtualFieldAccess(access *getter,
                      access *setter = 0,
                      access *caller = 0)
-    : getter(getter), setter(setter) {}
+    : getter(getter), setter(setter), caller(caller) {}
 
   virtualFieldAccess(vm::bltin getter,
                      vm::bltin setter = 0,
@@ -15,6 +15,14 @@ namespace vm {
 struct lambda; class stack;
 typedef void (*bltin)(stack *s);
 
+// The sampling profiler of sampler.h records the names of the bltin
+// functions registered while it is running.
+extern bool sampling;
+void nameBuiltin(bltin b, const string& name);
+
+#define NAME_BLTIN(b, s)                                        \
+  ((void) (vm::sampling && (vm::nameBuiltin((b), (s)), true)))
+
 #ifdef DEBUG_BLTIN
 // This associates names to bltin functions, so that the output of 'asy -s'
 // can print the names of the bltin functions that appear in the bytecode.
@@ -22,9 +30,12 @@ void registerBltin(bltin b, string s);
 string lookupBltin(bltin b);
 
 #define REGISTER_BLTIN(b, s)                    \
-  registerBltin((b), (s))
+  (registerBltin((b), (s)), NAME_BLTIN(b, s))
+#define NAMING_BLTINS true
 #else
-#define REGISTER_BLTIN(b, s)
+#define REGISTER_BLTIN(b, s) NAME_BLTIN(b, s)
+// Whether the names of the bltin functions are wanted.
+#define NAMING_BLTINS vm::sampling
 #endif
 
 void run(lambda *l);